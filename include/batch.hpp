@@ -0,0 +1,87 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - batch.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_BATCH_HPP
+#define _CHIP8_BATCH_HPP
+
+
+// ------- BATCH Class ------- //
+
+/*
+A container class for the chip8-batch program. Every ROM runs headless
+on its own CPU inside a POOL job for a fixed budget and produces a
+result record. With --lanes a job runs that many copies of its ROM on
+a LOCKSTEP instead.
+*/
+
+class BATCH {
+public:
+  // Batch public functions
+  void initialize(const int argc, const char *argv[]);
+  void run();
+  void finalize();
+
+private:
+  // Batch result record
+  struct RESULT {
+    std::string rom;
+    std::uint64_t cycles;
+    std::array<Byte, 16> registers;
+    Word i;
+    Word pc;
+    std::uint32_t hash;
+    double seconds;
+    unsigned int lanes;
+    double vectorized;      // Share of lane instructions run as a group
+    bool halted;
+    bool waiting;
+  };
+
+  // Batch variables
+  bool ready;
+  unsigned int threads;
+  unsigned int frames;
+  unsigned int lanes;
+  std::uint64_t max_cycles;
+  std::uint64_t seed;
+  CPU::ENGINE engine;
+
+  std::string output_path;
+  std::vector<std::string> roms;
+  std::vector<RESULT> results;
+
+  // Batch components
+  DISPLAY config;
+  POOL pool;
+
+  // Batch private functions
+  void parse(const int argc, const char *argv[]);
+  void usage(const std::string& name);
+  void execute(const std::size_t& job);
+  void executeLockstep(const std::size_t& job);
+  void report(std::ostream& out);
+
+  static std::uint32_t hash(const Frame& display);
+};
+
+#endif // _CHIP8_BATCH_HPP
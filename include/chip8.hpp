@@ -44,13 +44,26 @@ types and libraries used by the application
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <memory>
 #include <cstdint>
+#include <cstddef>
+#include <cstdlib>
 
 #include <string>
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <bitset>
+#include <type_traits>
 #include <random>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <experimental/filesystem>
 
 // Dependencies
@@ -65,6 +78,7 @@ class CPU;
 typedef std::uint8_t Byte;
 typedef std::uint16_t Word;
 typedef void (CPU::*OPFUNC)();
+typedef std::array<std::uint64_t, 32> Frame;   // 64x32 pixels, pixel x of a row is bit 63 - x
 
 static const unsigned char c8_fontset[80] =
 {
@@ -106,15 +120,36 @@ static const SDL_Keycode chip8_key[16] =
     SDLK_v
 };
 
+static const SDL_Keycode save_key = SDLK_F5;    // Quick save to <ROM_PATH>.state
+static const SDL_Keycode load_key = SDLK_F9;    // Quick load from <ROM_PATH>.state
+static const SDL_Keycode rewind_key = SDLK_BACKSPACE;   // Hold to run backwards
+static const SDL_Keycode turbo_key = SDLK_TAB;          // Hold to fast forward
+
 
 // ------- LOCAL INCLUDES ------- //
 
 // Local includes
 #include "json.hpp"
 #include "memory.hpp"
+#include "timer.hpp"
+#include "random.hpp"
+#include "snapshot.hpp"
+#include "rewind.hpp"
+#include "movie.hpp"
+#include "scheduler.hpp"
+#include "jit.hpp"
+#include "ring.hpp"
+#include "triple.hpp"
+#include "video.hpp"
 #include "display.hpp"
 #include "debug.hpp"
+#include "profiler.hpp"
+#include "timeline.hpp"
 #include "cpu.hpp"
+#include "lockstep.hpp"
 #include "system.hpp"
+#include "pool.hpp"
+#include "batch.hpp"
+#include "trace.hpp"
 
 #endif // _CHIP8_HPP
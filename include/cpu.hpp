@@ -25,22 +25,38 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 #define _CHIP8_CPU_HPP
 
 
+// ------- CPU Constants ------- //
+
+static const unsigned int BLOCK_MAX = 64;   // Longest translated basic block
+
+
 // ------- CPU Class ------- //
 
 /*
-The CHIP8 CPU implemented in a class. This requires call back functions
-to be passed to utilise relevant functions such as draw()
+The CHIP8 CPU implemented in a class. CLS and DXYN only mark the area
+of the framebuffer they changed, presenting it is left to the owner of
+the CPU.
 */
 
 class CPU {
+  friend class LOCKSTEP;
+
 public:
+  // CPU enumeration
+  enum class ENGINE { INTERPRETER, JIT, THREADED };
+
   // CPU public functions
-  void initialize(DISPLAY *d, DEBUG *dbg);
-  void update();
+  void initialize(DEBUG *dbg);
+  unsigned int run(const unsigned int& cycles);
   void reset();
+  void finalize();
 
   void open(const std::string& path, const Word& offset);
 
+  // CPU save states
+  void save(SNAPSHOT& state);
+  bool load(const SNAPSHOT& state);
+
   // CPU debug functions
   // void Debug(const std::string& path, const bool& enabled);
   // void debugStart() { dbug.start(); }
@@ -48,22 +64,83 @@ public:
 
   const bool& isHalt() { return halt; }
   void setHalt(const bool& h) { halt = h; }
+  const bool& isWaiting() { return waiting; }
+  bool isDirty() { return !dirty.empty(); }
+  const RECT& getDirty() { return dirty; }
+  void clearDirty() { dirty = RECT{}; }
+  const std::uint64_t& getCycles() { return timer.getElapsed(); }
+  const std::array<Byte, 16>& getRegisters() { return registers; }
+  const Frame& getDisplay() { return display; }
+  const Word& getI() { return i; }
+  const Word& getPC() { return pc; }
+
+  void setClock(const unsigned int& hz) { timer.setClock(hz); }
 
   void setKey(const int& n);
 
+  void setProfiler(PROFILER *p) { profiler = p; }
+  void setSeed(const std::uint64_t& s) { seed = s; rng.seed(s); }
+
+  void setEngine(const ENGINE& e);
+  void setDifferential(const bool& d) { differential = d; }
+
+  static const char *describe(const Byte& id);
+
 private:
+  // CPU opcode identifiers, in handler table order
+  enum OPID : Byte {
+    OP_NONE, OP_NOP, OP_SYS, OP_CLS, OP_RET, OP_JMP, OP_CAL, OP_SI, OP_SNEN,
+    OP_SE, OP_LDN, OP_ADN, OP_LDX, OP_ORX, OP_ANX, OP_XOR, OP_ADC, OP_SUB,
+    OP_SRH, OP_SUBN, OP_SHL, OP_SNEY, OP_LDI, OP_JPA, OP_RND, OP_DRW, OP_SKP,
+    OP_SKNP, OP_LXD, OP_LDK, OP_LDT, OP_LSX, OP_ADI, OP_LDS, OP_LDB, OP_LDM,
+    OP_RDX, OP_COUNT
+  };
+
+  // CPU decoded instruction
+  struct INSTRUCTION {
+    OPFUNC func;    // Opcode handler
+    Word opcode;    // Raw opcode
+    Word nnn;       // Address operand
+    Byte x;         // Register X operand
+    Byte y;         // Register Y operand
+    Byte n;         // Nibble operand
+    Byte nn;        // Byte operand
+    Byte id;        // Opcode identifier
+  };
+
+  // CPU translated basic block
+  struct BLOCK {
+    Word start;                             // Address of the first instruction
+    Word end;                               // Address past the last instruction
+    std::vector<const INSTRUCTION*> code;   // Pre-decoded straight-line instructions
+  };
+
+  // CPU decode table indexed by opcode and handlers indexed by OPID
+  static const std::array<INSTRUCTION, 0x10000> decode_table;
+  static const INSTRUCTION truncated;     // Decoded at 0xFFF where no whole opcode fits
+  static const std::array<OPFUNC, OP_COUNT> handlers;
+  static const std::array<const char*, OP_COUNT> mnemonics;
+
   // CPU variables
   bool initialized;
   bool halt;
+  bool waiting;
+  bool differential;
   Word opcode;
+  ENGINE engine;
 
   // CPU pointers
-  OPFUNC opfunc;
-  DISPLAY *window;
+  const INSTRUCTION *instr;
   DEBUG *debug;
+  PROFILER *profiler;
 
   // CPU utilities
   CHIP8_MEMORY memory;
+  JIT jit;
+  std::array<const INSTRUCTION*, MEM_SIZE> icache;   // Decoded instructions by address
+  std::array<std::unique_ptr<BLOCK>, MEM_SIZE> blocks; // Basic blocks by start address
+  std::bitset<MEM_SIZE> block_map;                     // Bytes covered by a basic block
+  unsigned int flushes;                                // Count of block invalidations
 
   // CPU registers
   std::array<Byte, 16> registers;
@@ -71,12 +148,16 @@ private:
   Word pc;
   Byte sp;
   std::array<Word, 16> stack;
-  std::array<unsigned char, 2048> display;
+  Frame display;
+  RECT dirty;           // Framebuffer area changed since it was last presented
   std::array<Byte, 16> key;
 
   // CPU timers
-  Byte delay_timer;
-  Byte sound_timer;
+  CHIP8_TIMER timer;
+
+  // CPU random source for CXNN, reseeded by reset
+  RANDOM rng;
+  std::uint64_t seed;
 
   // CPU opcode functions
   void opcode_none();   // Function to catch missing
@@ -119,14 +200,54 @@ private:
   void opcode_ldm();    // FX55 - Store reg 0 -> reg x in mem[reg I]
   void opcode_rdx();    // FX65 - Read reg 0 -> reg x from mem[reg I]
 
+  // CPU decode table functions
+  static constexpr OPID decodeId(const Word& op);
+  static constexpr std::array<INSTRUCTION, 0x10000> buildDecodeTable();
+
   // CPU privte functions
-  void fetch();
-  void decode();
+  Word fetch(const Word& addr);
+  const INSTRUCTION *decode(const Word& addr);
   void execute();
-
-  const Byte& memory_read(const Word& addr);
-  void memory_write(const Word& addr, const Byte& value);
-  Byte randomNumber(const Byte& l, const Byte& h);
+  void step();
+  unsigned int dispatch(const unsigned int& budget);
+  unsigned int runNative(const unsigned int& budget);
+  unsigned int runThreaded(const unsigned int& count);
+
+  // CPU basic block functions
+  unsigned int runBlock(const unsigned int& budget);
+  const BLOCK *translate(const Word& addr);
+  void clearBlocks();
+  void flushBlocks(const Word& addr);
+  void invalidate(const Word& addr);
+  static bool endsBlock(const INSTRUCTION *op);
+
+  // CPU profiling hook for the instruction about to execute
+  void profile() {
+    if(profiler != nullptr)
+      profiler->count(instr->id, pc);
+  }
+
+  // CPU tracing hooks, compiled out entirely without CHIP8_TRACE
+  void trace() {
+    if constexpr(TRACE_ENABLED)
+      debug->log_cpu_state(opcode, registers, i, pc, sp);
+  }
+
+  // Addresses past the end of memory, I + n or PC + 1 near 0xFFF, wrap around
+  const Byte& memory_read(const Word& addr) {
+    const Word wrapped = addr & (MEM_SIZE - 1);
+    if constexpr(TRACE_ENABLED)
+      debug->log_mem_read(wrapped, memory.read(wrapped));
+    return memory.read(wrapped);
+  }
+
+  void memory_write(const Word& addr, const Byte& value) {
+    const Word wrapped = addr & (MEM_SIZE - 1);
+    if constexpr(TRACE_ENABLED)
+      debug->log_mem_write(wrapped, value);
+    memory.write(wrapped, value);
+    invalidate(wrapped);
+  }
 };
 
 
@@ -25,26 +25,87 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 #define _CHIP8_DEBUG_HPP
 
 
+// ------- Debug Constants ------- //
+
+// Tracing hooks are only compiled into the CPU when CHIP8_TRACE is set
+#ifdef CHIP8_TRACE
+static constexpr bool TRACE_ENABLED = true;
+#else
+static constexpr bool TRACE_ENABLED = false;
+#endif
+
+static const char TRACE_MAGIC[4] = { 'C', '8', 'T', 'R' };
+static const Word TRACE_VERSION = 1;
+static const std::size_t TRACE_RING = 0x10000;    // Records buffered between the threads
+static const std::size_t TRACE_BLOCK = 0x1000;    // Records written to disk at once
+
+
 // ------- DEBUG Class ------- //
 
 /*
-A class that aids with debugging the CHIP8 Emulator by creating
-a log file with all operations
+A class that aids with debugging the CHIP8 Emulator by tracing all
+operations to a binary log file. Records are fixed size and go through
+a lock-free ring to a thread that writes them out in large blocks, the
+chip8-trace tool turns a trace back into the text layout.
 */
 
 class DEBUG {
 public:
+  // Debug trace record types
+  enum TYPE : Byte { TRACE_CPU, TRACE_READ, TRACE_WRITE };
+
+  // Debug trace record, memory records keep the address in opcode and
+  // the value in i. Fields are stored in host byte order.
+  struct RECORD {
+    Byte type;
+    Byte sp;
+    Word opcode;
+    Word i;
+    Word pc;
+    std::array<Byte, 16> registers;
+  };
+
+  // Debug trace file header
+  struct HEADER {
+    char magic[4];
+    Word version;
+    Word size;
+  };
+
   // Debug public functions
   void start();
   void stop();
 
-  void log_cpu_state(const Word& opcode, const std::array<Byte, 16>& registers, const Word& i, const Word& pc, const Byte& sp);
-  void log_mem_read(const Word& addr, const Byte& value);
-  void log_mem_write(const Word& addr, const Byte& value);
+  // Debug hooks, inline so a disabled DEBUG costs one branch
+  void log_cpu_state(const Word& opcode, const std::array<Byte, 16>& registers, const Word& i, const Word& pc, const Byte& sp) {
+    if(!enabled)
+      return;
+
+    RECORD record;
+    record.type = TRACE_CPU;
+    record.sp = sp;
+    record.opcode = opcode;
+    record.i = i;
+    record.pc = pc;
+    record.registers = registers;
+    push(record);
+  }
+
+  void log_mem_read(const Word& addr, const Byte& value) {
+    if(enabled)
+      push(RECORD{TRACE_READ, 0, addr, value, 0, {}});
+  }
+
+  void log_mem_write(const Word& addr, const Byte& value) {
+    if(enabled)
+      push(RECORD{TRACE_WRITE, 0, addr, value, 0, {}});
+  }
 
   void initialize(const std::string& path) { log_path = path; }
   void setEnabled(const bool& e) { enabled = e;}
 
+  static void format(std::ostream& out, const RECORD& record);
+
 private:
   // Debug variables
   bool enabled;
@@ -52,7 +113,17 @@ private:
   std::string log_path;
   std::ofstream output;
 
+  // Debug trace writer
+  std::unique_ptr<RING<RECORD, TRACE_RING>> ring;
+  std::thread writer;
+  std::atomic<bool> writing;
+
+  // Debug private functions
+  void push(const RECORD& record);
+  void drain();
 };
 
+static_assert(sizeof(DEBUG::RECORD) == 24, "DEBUG::RECORD must stay 24 bytes");
+
 
-#endif // _CH8P_DEBUG_HPP
+#endif // _CHIP8_DEBUG_HPP
@@ -29,26 +29,33 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 
 /*
 A container class for the SDL Display which handles
-window updates and configuration
+window updates and configuration. Frames are expanded into a
+SCREEN_W x SCREEN_H streaming texture which is scaled to the window
+in a single copy. Only the changed area of the texture is uploaded.
 */
 
-class DISPLAY {
+class DISPLAY : public VIDEO {
 public:
   // Display public functions
+  void configure();
   void initialize();
-  void draw(const std::array<Byte, 2048>& display);
+  void draw(const Frame& display, const RECT& area) override;
   void clear();
   void finalize();
 
-  const float& getDelay() { return app_delay; }
+  const unsigned int& getClock() { return app_clock; }
 
 private:
   // Display variables
   bool initialized;
   SDL_Window *window;
   SDL_Renderer *render;
+  SDL_Texture *texture;
+  SDL_Rect screen;                        // Texture destination in the window
+  std::array<std::uint32_t, 2> palette;   // ARGB8888 colour of off and on pixels
+  std::array<std::uint32_t, SCREEN_W * SCREEN_H> pixels;   // Upload staging area
 
-  float app_delay;
+  unsigned int app_clock;
   unsigned int app_w;
   unsigned int app_h;
   unsigned int pixel_h;
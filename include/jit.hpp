@@ -0,0 +1,102 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - jit.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_JIT_HPP
+#define _CHIP8_JIT_HPP
+
+
+// ------- JIT Constants ------- //
+
+static const std::size_t JIT_BUFFER = 0x100000;  // Bytes of executable memory
+
+
+// ------- JIT Class ------- //
+
+/*
+An x86-64 dynamic recompiler. Straight-line runs of register only
+instructions are translated to native code which keeps the CHIP8
+registers used by the run in host registers. Everything else is left
+to the interpreter.
+*/
+
+class JIT {
+public:
+  // JIT machine state passed to native code
+  struct CONTEXT {
+    std::array<Byte, 16> registers;
+    Word i;
+    Word pc;
+  };
+
+  typedef void (*BLOCKFUNC)(CONTEXT *ctx);
+
+  // JIT translated block, func is nullptr when nothing could be translated
+  struct BLOCK {
+    BLOCKFUNC func;
+    Word start;
+    Word end;
+    unsigned int count;
+  };
+
+  // JIT public functions
+  bool initialize();
+  void finalize();
+  void reset();
+
+  const BLOCK *lookup(CHIP8_MEMORY& memory, const Word& pc);
+  void invalidate(const Word& addr);
+
+private:
+  // JIT variables
+  bool initialized;
+  Byte *buffer;
+  std::size_t used;
+
+  std::array<std::unique_ptr<BLOCK>, MEM_SIZE> blocks;
+  std::bitset<MEM_SIZE> block_map;
+  std::vector<Byte> code;
+
+  // JIT register allocation
+  std::array<int, 17> host;     // Host register for V0-VF and I, -1 when unused
+  unsigned int allocated;
+
+  // JIT private functions
+  const BLOCK *compile(CHIP8_MEMORY& memory, const Word& pc);
+  bool allocate(const std::uint32_t& mask);
+  void translate(const Word& op);
+  BLOCKFUNC install();
+
+  // JIT x86-64 emitters
+  void emit(const Byte& b) { code.push_back(b); }
+  void emit32(const std::uint32_t& v);
+  void emitRR(const Byte& op, const int& dst, const int& src);
+  void emitImm(const Byte& ext, const int& dst, const std::uint32_t& imm);
+  void emitShift(const Byte& ext, const int& dst, const Byte& imm);
+  void emitMov(const int& dst, const std::uint32_t& imm);
+  void emitLoad(const int& dst, const Byte& offset, const bool& word);
+  void emitStore(const int& src, const Byte& offset, const bool& word);
+  void emitSetCarry(const int& a, const int& b);
+};
+
+
+#endif // _CHIP8_JIT_HPP
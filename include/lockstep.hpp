@@ -0,0 +1,105 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - lockstep.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_LOCKSTEP_HPP
+#define _CHIP8_LOCKSTEP_HPP
+
+
+// ------- LOCKSTEP Constants ------- //
+
+static const unsigned int LOCKSTEP_GROUP = 32;   // Lanes in one 256 bit vector of bytes
+
+
+// ------- LOCKSTEP Class ------- //
+
+/*
+Runs many copies of one ROM in lockstep. V0-VF, I, PC and the timers of
+every lane are kept in struct-of-arrays form and lanes are processed in
+groups of LOCKSTEP_GROUP. When every live lane of a group sits on the
+same register only instruction it is executed for the whole group at
+once, with AVX2 where the host has it. Anything else runs lane by lane
+on the lane's own CPU, which also owns its memory, stack and display.
+*/
+
+class LOCKSTEP {
+public:
+  // Lockstep public functions
+  void initialize(const unsigned int& n, const unsigned int& clock);
+  void open(const std::string& path, const Word& offset);
+  unsigned int run(const unsigned int& cycles);
+  void finalize();
+
+  CPU *getLane(const unsigned int& lane);
+  void setKey(const unsigned int& lane, const int& n);
+  void setSeed(const std::uint64_t& seed);
+
+  bool isStopped();
+  const unsigned int& getLanes() { return lanes; }
+  const std::uint64_t& getCycles() { return elapsed; }
+  const std::uint64_t& getVectorized() { return vectorized; }
+  const std::uint64_t& getScalar() { return scalar; }
+
+private:
+  // Lockstep variables
+  bool avx2;
+  unsigned int lanes;
+  unsigned int groups;
+  std::size_t stride;               // Lanes rounded up to whole groups
+
+  // Lockstep emulated time shared by every lane
+  unsigned int clock;
+  unsigned int accumulator;
+  std::uint64_t elapsed;
+
+  // Lockstep counters of lane instructions by path
+  std::uint64_t vectorized;
+  std::uint64_t scalar;
+
+  // Lockstep lane state, element [r * stride + lane] is Vr of a lane
+  std::vector<Byte> registers;
+  std::vector<Word> index;
+  std::vector<Word> pcs;
+  std::vector<Byte> delay;
+  std::vector<Byte> sound;
+  std::vector<Byte> active;         // 0xFF for lanes still running
+  std::vector<bool> shared;         // Group memory still identical to the ROM
+
+  // Lockstep lane machines
+  DEBUG debug;
+  std::vector<std::unique_ptr<CPU>> cpus;
+
+  // Lockstep private functions
+  void runGroup(const unsigned int& group, const unsigned int& cycles);
+  const CPU::INSTRUCTION *uniform(const unsigned int& group);
+  void executeGroup(const unsigned int& group, const CPU::INSTRUCTION *op);
+  void executeGroupAVX2(const unsigned int& group, const CPU::INSTRUCTION *op);
+  void executeLane(const unsigned int& lane);
+  void tick(const unsigned int& group, const unsigned int& ticks);
+  void load(const unsigned int& lane);
+  void store(const unsigned int& lane);
+
+  static bool vectorizable(const CPU::INSTRUCTION *op);
+};
+
+
+#endif // _CHIP8_LOCKSTEP_HPP
@@ -27,7 +27,7 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 
 // ------- Memory Constants ------- //
 
-static const Word MEM_SIZE = 0xFFF;
+static const Word MEM_SIZE = 0x1000;
 
 
 // ------- CHIP8_MEMORY Class ------- //
@@ -45,8 +45,11 @@ public:
   void open(const std::string& path, const Word& offset);
   void reset();
 
-  void write(const Word& addr, const Byte& value);
-  const Byte& read(const Word& addr);
+  void write(const Word& addr, const Byte& value) { MEMORY[addr] = value; }
+  const Byte& read(const Word& addr) { return MEMORY[addr]; }
+
+  const std::array<Byte, MEM_SIZE>& getData() { return MEMORY; }
+  void setData(const std::array<Byte, MEM_SIZE>& data) { MEMORY = data; }
 
 };
 
@@ -0,0 +1,86 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - movie.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_MOVIE_HPP
+#define _CHIP8_MOVIE_HPP
+
+
+// ------- Movie Constants ------- //
+
+static const char MOVIE_MAGIC[4] = { 'C', '8', 'M', 'V' };
+static const std::uint32_t MOVIE_VERSION = 1;
+
+
+// ------- MOVIE Class ------- //
+
+/*
+A recording of every key press of a session, stamped with the emulated
+cycle it reached the CPU at. Together with the seed and clock in the
+header that is all that is needed to run the session again exactly.
+Each event is one 64 bit word, the cycle shifted left by 8 with the key
+in the low byte. Movies are kept in memory and written in one go, with
+a digest of the final machine so a replay can check it ended the same.
+*/
+
+class MOVIE {
+public:
+  // Movie file header
+  struct HEADER {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t clock;
+    std::uint32_t count;          // Events following the header
+    std::uint64_t seed;
+    std::uint64_t end;            // Cycle the recording stopped at
+    std::uint64_t digest;         // SNAPSHOT::digest of the machine at the end
+  };
+
+  // Movie recording functions
+  void initialize(const std::uint64_t& seed, const unsigned int& clock);
+  void record(const std::uint64_t& cycle, const int& key) {
+    events.push_back((cycle << 8) | Byte(key));
+  }
+  void truncate(const std::size_t& count);
+  bool write(const std::string& path, const std::uint64_t& end, const std::uint64_t& digest);
+
+  // Movie replay functions
+  bool read(const std::string& path);
+  bool due(const std::uint64_t& cycle, int& key);
+  bool finished() { return cursor >= events.size(); }
+  std::uint64_t next() { return events[cursor] >> 8; }
+
+  const std::uint64_t& getSeed() { return header.seed; }
+  const std::uint32_t& getClock() { return header.clock; }
+  const std::uint64_t& getEnd() { return header.end; }
+  const std::uint64_t& getDigest() { return header.digest; }
+  std::size_t getCount() { return events.size(); }
+
+private:
+  // Movie variables
+  HEADER header;
+  std::vector<std::uint64_t> events;
+  std::size_t cursor;
+};
+
+
+#endif // _CHIP8_MOVIE_HPP
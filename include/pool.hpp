@@ -0,0 +1,74 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - pool.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_POOL_HPP
+#define _CHIP8_POOL_HPP
+
+
+// ------- POOL Class ------- //
+
+/*
+A work-stealing thread pool. Every worker owns a queue, takes its own
+newest job first and steals the oldest job from another worker when
+its queue runs dry.
+*/
+
+class POOL {
+public:
+  typedef std::function<void()> JOB;
+
+  // Pool public functions
+  void initialize(const unsigned int& threads);
+  void submit(JOB job);
+  void wait();
+  void finalize();
+
+  std::size_t size() { return workers.size(); }
+
+private:
+  // Pool worker queue
+  struct QUEUE {
+    std::mutex lock;
+    std::deque<JOB> jobs;
+  };
+
+  // Pool variables
+  std::vector<std::unique_ptr<QUEUE>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<bool> running;
+  std::atomic<std::size_t> pending;   // Jobs not yet finished
+  std::atomic<std::size_t> queued;    // Jobs not yet started
+  std::size_t next;
+
+  std::mutex signal_lock;
+  std::condition_variable work_ready;
+  std::condition_variable work_done;
+
+  // Pool private functions
+  void work(const std::size_t& id);
+  bool pop(const std::size_t& id, JOB& job);
+  bool steal(const std::size_t& id, JOB& job);
+};
+
+
+#endif // _CHIP8_POOL_HPP
@@ -0,0 +1,104 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - profiler.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_PROFILER_HPP
+#define _CHIP8_PROFILER_HPP
+
+
+// ------- Profiler Constants ------- //
+
+static const std::size_t PROFILE_OPS = 0x100;     // Room for every opcode identifier
+static const std::size_t PROFILE_TOP = 20;        // Hot spots shown in the report
+static const std::size_t PROFILE_BUCKETS = 24;    // Power of two buckets of draw intervals
+
+
+// ------- PROFILER Class ------- //
+
+/*
+Counts where a ROM spends its instructions. The CPU calls count() for
+every instruction and draw() from DXYN when a PROFILER is attached.
+With a sample period of N only every Nth instruction is recorded in the
+opcode and address histograms, weighted by N, while the instruction
+total and the intervals between DXYN stay exact.
+*/
+
+class PROFILER {
+public:
+  // Profiler public functions
+  void initialize(const unsigned int& period);
+  void reset();
+
+  // Profiler hooks called by the CPU
+  void count(const Byte& id, const Word& pc) {
+    instructions++;
+    if(--countdown != 0)
+      return;
+
+    countdown = period;
+    ops[id] += period;
+    hits[pc & (MEM_SIZE - 1)] += period;
+  }
+
+  void draw() {
+    const std::uint64_t interval = instructions - last_draw;
+    last_draw = instructions;
+
+    if(draws++ > 0) {
+      shortest = std::min(shortest, interval);
+      longest = std::max(longest, interval);
+      total_interval += interval;
+
+      unsigned int bucket = 0;
+      while(bucket + 1 < PROFILE_BUCKETS && (std::uint64_t(2) << bucket) <= interval)
+        bucket++;
+      intervals[bucket]++;
+    }
+  }
+
+  // Profiler reports
+  void report(std::ostream& out);
+  void write(const std::string& path);
+
+private:
+  // Profiler variables
+  unsigned int period;
+  unsigned int countdown;
+  std::uint64_t instructions;
+
+  std::array<std::uint64_t, PROFILE_OPS> ops;
+  std::array<std::uint64_t, MEM_SIZE> hits;
+
+  // Profiler DXYN intervals in instructions
+  std::uint64_t draws;
+  std::uint64_t last_draw;
+  std::uint64_t shortest;
+  std::uint64_t longest;
+  std::uint64_t total_interval;
+  std::array<std::uint64_t, PROFILE_BUCKETS> intervals;
+
+  // Profiler private functions
+  std::vector<std::pair<std::uint64_t, std::size_t>> sorted(const std::uint64_t *counts, const std::size_t& size);
+};
+
+
+#endif // _CHIP8_PROFILER_HPP
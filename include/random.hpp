@@ -0,0 +1,79 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - random.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_RANDOM_HPP
+#define _CHIP8_RANDOM_HPP
+
+
+// ------- RANDOM Class ------- //
+
+/*
+A xoshiro256** generator for CXNN. It is seeded once through splitmix64
+so any 64 bit seed, including 0 and consecutive values, gives a well
+mixed and independent state. The same seed always gives the same bytes.
+*/
+
+class RANDOM {
+public:
+  // Random public functions
+  void seed(std::uint64_t value) {
+    for(std::uint64_t& word : state) {
+      value += 0x9E3779B97F4A7C15ull;
+      std::uint64_t z = value;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  std::uint64_t next() {
+    const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const std::uint64_t t = state[1] << 17;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+
+    return result;
+  }
+
+  // The high bits are the strongest
+  Byte byte() { return Byte(next() >> 56); }
+
+  const std::array<std::uint64_t, 4>& getState() { return state; }
+  void setState(const std::array<std::uint64_t, 4>& s) { state = s; }
+
+private:
+  // Random variables
+  std::array<std::uint64_t, 4> state;
+
+  static std::uint64_t rotl(const std::uint64_t& x, const int& k) {
+    return (x << k) | (x >> (64 - k));
+  }
+};
+
+
+#endif // _CHIP8_RANDOM_HPP
@@ -0,0 +1,82 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - rewind.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_REWIND_HPP
+#define _CHIP8_REWIND_HPP
+
+
+// ------- Rewind Constants ------- //
+
+static const std::size_t REWIND_BYTES = 0x400000;   // Delta storage, minutes of history at 60 Hz
+static const std::size_t REWIND_GAP = 4;            // Unchanged bytes that end a literal run
+
+
+// ------- REWIND Class ------- //
+
+/*
+A fixed size history of SNAPSHOTs. Only the newest snapshot is kept
+whole; every older one is stored as the XOR of it and its successor,
+run length encoded so unchanged bytes cost nothing. Stepping back XORs
+the newest delta into the current snapshot, no emulation is replayed.
+Deltas live in one circular byte buffer and the oldest are dropped
+when it fills up.
+
+A delta is a series of runs, each a Word count of unchanged bytes to
+skip, a Word count of changed bytes and that many XORed bytes.
+*/
+
+class REWIND {
+public:
+  // Rewind public functions
+  void initialize(const std::size_t& bytes);
+  void reset();
+
+  void push(const SNAPSHOT& state);
+  bool pop(SNAPSHOT& state);
+
+  std::size_t getFrames() { return entries.size(); }
+  std::size_t getUsed() { return used; }
+
+private:
+  // Rewind delta position in the buffer
+  struct ENTRY {
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  // Rewind variables
+  bool started;
+  SNAPSHOT current;             // Newest snapshot, the deltas lead back from it
+  std::vector<Byte> buffer;
+  std::deque<ENTRY> entries;    // Oldest first
+  std::vector<Byte> delta;      // Scratch space for encoding
+  std::size_t used;
+
+  // Rewind private functions
+  void encode(const Byte *from, const Byte *to, const std::size_t& size);
+  bool store();
+  void drop();
+};
+
+
+#endif // _CHIP8_REWIND_HPP
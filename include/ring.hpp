@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - ring.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_RING_HPP
+#define _CHIP8_RING_HPP
+
+
+// ------- RING Class ------- //
+
+/*
+A lock-free single producer, single consumer ring of SIZE elements.
+SIZE must be a power of two. One thread pushes and one thread pops,
+push fails when the ring is full and pop fails when it is empty.
+*/
+
+template<typename T, std::size_t SIZE>
+class RING {
+  static_assert((SIZE & (SIZE - 1)) == 0, "RING size must be a power of two");
+
+public:
+  // Ring producer functions
+  bool push(const T& value) {
+    const std::size_t tail = write.load(std::memory_order_relaxed);
+    if(tail - read.load(std::memory_order_acquire) == SIZE)
+      return false;
+
+    slots[tail & (SIZE - 1)] = value;
+    write.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Ring consumer functions
+  bool pop(T& value) {
+    const std::size_t head = read.load(std::memory_order_relaxed);
+    if(head == write.load(std::memory_order_acquire))
+      return false;
+
+    value = slots[head & (SIZE - 1)];
+    read.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t pop(T *values, const std::size_t& count) {
+    // Take up to count values at once, returns how many were taken
+    const std::size_t head = read.load(std::memory_order_relaxed);
+    const std::size_t available = write.load(std::memory_order_acquire) - head;
+    const std::size_t taken = std::min(available, count);
+
+    for(std::size_t n = 0; n < taken; n++)
+      values[n] = slots[(head + n) & (SIZE - 1)];
+
+    read.store(head + taken, std::memory_order_release);
+    return taken;
+  }
+
+  std::size_t size() {
+    return write.load(std::memory_order_acquire) - read.load(std::memory_order_acquire);
+  }
+
+private:
+  // Ring variables, the indices only ever grow and wrap by masking
+  std::array<T, SIZE> slots;
+  alignas(64) std::atomic<std::size_t> write{0};
+  alignas(64) std::atomic<std::size_t> read{0};
+};
+
+
+#endif // _CHIP8_RING_HPP
@@ -0,0 +1,74 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - scheduler.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_SCHEDULER_HPP
+#define _CHIP8_SCHEDULER_HPP
+
+
+// ------- Scheduler Constants ------- //
+
+static const unsigned int SCHEDULER_RESYNC = 5;     // Frames behind before the debt is dropped
+static const std::chrono::microseconds SCHEDULER_SPIN_MIN(100);    // Bounds on the time left to spin
+static const std::chrono::microseconds SCHEDULER_SPIN_MAX(2000);
+
+
+// ------- SCHEDULER Class ------- //
+
+/*
+Paces emulation in real time. Every frame gets clock / rate instructions,
+with the remainder carried over so the long run rate is exact, and ends
+at an absolute deadline on the steady clock so sleeping late never adds
+up to drift. Waiting sleeps until shortly before the deadline and spins
+the rest; the spin margin follows how late the OS has been waking us.
+When emulation falls SCHEDULER_RESYNC frames behind, after a stall or
+while fast forwarding, the schedule restarts from now instead of
+running flat out to catch up.
+*/
+
+class SCHEDULER {
+public:
+  // Scheduler public functions
+  void initialize(const unsigned int& clock, const unsigned int& rate);
+  void reset();
+
+  unsigned int next();
+  void wait();
+
+  const std::uint64_t& getResyncs() { return resyncs; }
+
+private:
+  typedef std::chrono::steady_clock CLOCK;
+
+  // Scheduler variables
+  unsigned int clock;             // Instructions per second
+  unsigned int rate;              // Frames per second
+  unsigned int accumulator;       // Instructions owed to the next frames times rate
+
+  CLOCK::time_point origin;       // Start of frame zero
+  std::uint64_t frames;           // Frames since origin
+  CLOCK::duration margin;         // Time before a deadline spent spinning
+  std::uint64_t resyncs;
+};
+
+
+#endif // _CHIP8_SCHEDULER_HPP
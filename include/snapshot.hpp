@@ -0,0 +1,86 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - snapshot.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_SNAPSHOT_HPP
+#define _CHIP8_SNAPSHOT_HPP
+
+
+// ------- Snapshot Constants ------- //
+
+static const char SNAPSHOT_MAGIC[4] = { 'C', '8', 'S', 'S' };
+static const std::uint32_t SNAPSHOT_VERSION = 1;
+
+static const Byte SNAPSHOT_HALT = 0x1;      // Flag bits of a snapshot
+static const Byte SNAPSHOT_WAITING = 0x2;
+
+
+// ------- SNAPSHOT Structure ------- //
+
+/*
+The complete state of one machine in a fixed layout. It holds no
+pointers, so copying the struct is a snapshot and it is written to disk
+as is. Fields are ordered largest first to keep the layout free of
+padding. Bump SNAPSHOT_VERSION whenever the layout changes.
+*/
+
+struct SNAPSHOT {
+  // Snapshot header
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t size;             // sizeof(SNAPSHOT) when written
+
+  // Snapshot emulated time
+  std::uint32_t clock;
+  std::uint32_t accumulator;
+  std::uint32_t presses;          // Movie key presses recorded before the state
+  std::uint64_t elapsed;
+
+  // Snapshot random generator for CXNN
+  std::uint64_t seed;
+  std::array<std::uint64_t, 4> random;
+
+  // Snapshot machine state
+  Frame display;
+  std::array<Byte, MEM_SIZE> memory;
+  std::array<Word, 16> stack;
+  Word i;
+  Word pc;
+  std::array<Byte, 16> registers;
+  std::array<Byte, 16> key;
+  Byte sp;
+  Byte delay;
+  Byte sound;
+  Byte flags;
+
+  // Snapshot file functions
+  bool valid() const;
+  std::uint64_t digest() const;
+  bool read(const std::string& path);
+  bool write(const std::string& path) const;
+};
+
+static_assert(std::is_trivially_copyable<SNAPSHOT>::value, "SNAPSHOT must be copyable as bytes");
+static_assert(sizeof(SNAPSHOT) == 4496, "SNAPSHOT layout changed, bump SNAPSHOT_VERSION");
+
+
+#endif // _CHIP8_SNAPSHOT_HPP
@@ -24,11 +24,21 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 #ifndef _CHIP8_SYSTEM_HPP
 #define _CHIP8_SYSTEM_HPP
 
+
+// ------- System Constants ------- //
+
+static const std::size_t DAMAGE_MAX = 8;   // Unpresented frame areas kept apart
+static const unsigned int TURBO_SPEED = 8;  // Fast forward speed without --turbo
+static const unsigned int TURBO_MAX = 100;  // Fastest --turbo, keeps a frame's instructions in range
+
+
 // ------- SYSTEM Class ------- //
 
 /*
 A container class for the Chip8 Program that parses
- command line input and executes the desired result.
+ command line input and executes the desired result. With a window
+the CPU runs on its own thread, finished frames reach the main thread
+through a triple buffer and key presses travel back through a ring.
 */
 
 class SYSTEM {
@@ -42,25 +52,91 @@ public:
   void finalize();
 
 private:
+  // System frame handed to the render side
+  struct UPDATE {
+    Frame frame;
+    RECT area;                  // Changed since the last frame the renderer showed
+    std::uint64_t sequence;
+  };
+
+  // System input handed to the CPU thread
+  struct INPUT {
+    enum class TYPE { KEY, SAVE, LOAD, REWIND, TURBO } type;
+    int value;
+  };
+
+  // System area changed by a published frame
+  struct DAMAGE {
+    std::uint64_t sequence;
+    RECT area;
+  };
+
   // System Variables
   STATE state;
   bool config_enabled;
   bool debug_enabled;
+  bool diff_enabled;
+  bool headless;
+  bool profile_enabled;
+  bool timeline_enabled;
   SDL_Event event;
+  std::atomic<bool> running;
 
   std::string file_path;
   std::string debug_path;
-  float delay;
+  std::string profile_path;
+  std::string timeline_path;
+  std::string state_path;
+  std::string load_path;
+  unsigned int sample;
+  std::uint64_t seed;
+  bool seed_given;
+  bool recording;
+  bool replaying;
+  std::string movie_path;
+  unsigned int turbo;     // Speed multiplier when fast forwarding
+  bool turbo_enabled;     // Fast forward for the whole run
+  std::uint64_t max_cycles;
+  CPU::ENGINE engine;
 
   // System Components
   DISPLAY display;
+  HEADLESS null_display;
+  VIDEO *video;           // Sink frames are presented to
+  TRIPLE_BUFFER<UPDATE> frames;
+  std::deque<DAMAGE> unseen;              // Published but not yet presented
+  std::uint64_t published;
+  std::atomic<std::uint64_t> presented;
+  RING<INPUT, 64> inputs;
+  SNAPSHOT quicksave;
+  bool has_quicksave;
+  REWIND history;         // A snapshot per frame, owned by the CPU thread
+  SNAPSHOT frame_state;
+  bool rewinding;
+  bool fast_forward;      // Turbo key held
   DEBUG debug;
+  PROFILER profiler;
+  MOVIE movie;
+  TIMELINE timeline;
+  SCHEDULER scheduler;    // Real time pacing of the CPU thread
   CPU cpu;
 
   // System private functions
   bool fexist(const std::string& path);
   void parse(const int argc, const char *argv[]);
+  void usage(const std::string& name);
+  void publish();
+  bool present();
   void handleEvent();
+  void apply(const INPUT& input);
+  void save();
+  void load();
+  void frame(const unsigned int& count);
+  void emulate();
+  void runHeadless();
+  void writeProfile();
+  void writeMovie();
+  void checkReplay();
 
 };
 
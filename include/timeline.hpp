@@ -0,0 +1,114 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - timeline.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_TIMELINE_HPP
+#define _CHIP8_TIMELINE_HPP
+
+
+// ------- Timeline Constants ------- //
+
+static const std::size_t TIMELINE_TRACKS = 2;          // One per thread, main and CPU
+static const std::size_t TIMELINE_SPANS = 0x100000;    // Spans kept per track
+
+
+// ------- TIMELINE Class ------- //
+
+/*
+Records how long the parts of each frame take. Every track is a
+preallocated ring only ever written by one thread, so recording takes no
+locks, and once full the oldest spans are overwritten so a long session
+keeps its most recent frames. After the run the spans are written as
+Chrome trace events which Perfetto and chrome://tracing load.
+*/
+
+class TIMELINE {
+public:
+  // Timeline tracks
+  enum TRACK { MAIN, EMULATOR };
+
+  // Timeline completed span, times in nanoseconds from the start
+  struct SPAN {
+    const char *name;
+    std::uint64_t start;
+    std::uint64_t duration;
+  };
+
+  // Timeline public functions
+  void initialize(const bool& enable);
+  void write(const std::string& path);
+
+  bool isEnabled() { return enabled; }
+
+  std::uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - origin).count();
+  }
+
+  void record(const TRACK& track, const char *name, const std::uint64_t& start) {
+    // Wrap around the ring rather than reallocating
+    tracks[track][counts[track] % TIMELINE_SPANS] = SPAN{name, start, now() - start};
+    counts[track]++;
+  }
+
+private:
+  // Timeline variables
+  bool enabled;
+  std::chrono::steady_clock::time_point origin;
+  std::array<std::vector<SPAN>, TIMELINE_TRACKS> tracks;
+  std::array<std::uint64_t, TIMELINE_TRACKS> counts;
+};
+
+
+// ------- SCOPE Class ------- //
+
+/*
+Times the enclosing block as one span of a TIMELINE track. The name must
+outlive the timeline, string literals are expected. Nothing is recorded
+when the timeline is disabled.
+*/
+
+class SCOPE {
+public:
+  SCOPE(TIMELINE& timeline, const TIMELINE::TRACK& track, const char *name)
+    : timeline(timeline), track(track), name(name), start(0) {
+    if(timeline.isEnabled())
+      start = timeline.now();
+  }
+
+  ~SCOPE() {
+    if(timeline.isEnabled())
+      timeline.record(track, name, start);
+  }
+
+  SCOPE(const SCOPE&) = delete;
+  SCOPE& operator=(const SCOPE&) = delete;
+
+private:
+  TIMELINE& timeline;
+  const TIMELINE::TRACK track;
+  const char *name;
+  std::uint64_t start;
+};
+
+
+#endif // _CHIP8_TIMELINE_HPP
@@ -0,0 +1,84 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - timer.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_TIMER_HPP
+#define _CHIP8_TIMER_HPP
+
+
+// ------- Timer Constants ------- //
+
+static const unsigned int TIMER_HZ = 60;      // Delay and sound timer rate
+static const unsigned int CLOCK_HZ = 660;     // Default instructions per second
+
+
+// ------- CHIP8_TIMER Class ------- //
+
+/*
+A class to keep the emulated time. Time advances by executed
+instructions at the configured clock rate and the delay and sound
+timers count down at exactly TIMER_HZ of that time.
+*/
+
+class CHIP8_TIMER {
+public:
+  void reset();
+  void setClock(const unsigned int& hz);
+
+  // Advance emulated time by a number of executed instructions
+  void update(const unsigned int& cycles) {
+    elapsed += cycles;
+    accumulator += std::uint64_t(cycles) * TIMER_HZ;
+    if(accumulator >= clock)
+      tick();
+  }
+
+  const Byte& getDelay() { return delay; }
+  const Byte& getSound() { return sound; }
+  const std::uint64_t& getElapsed() { return elapsed; }
+  const unsigned int& getClock() { return clock; }
+  const std::uint64_t& getAccumulator() { return accumulator; }
+
+  void setDelay(const Byte& value) { delay = value; }
+  void setSound(const Byte& value) { sound = value; }
+
+  // Restore emulated time from a save state
+  void restore(const unsigned int& hz, const unsigned int& acc, const std::uint64_t& e) {
+    clock = (hz > 0) ? hz : CLOCK_HZ;
+    accumulator = acc % clock;
+    elapsed = e;
+  }
+
+private:
+  // Timer variables
+  Byte delay;
+  Byte sound;
+
+  unsigned int clock;           // Instructions per emulated second
+  std::uint64_t accumulator;    // TIMER_HZ * instructions not yet ticked, wide for FX0A budgets
+  std::uint64_t elapsed;        // Instructions since reset
+
+  void tick();
+};
+
+
+#endif // _CHIP8_TIMER_HPP
@@ -0,0 +1,57 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - trace.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_TRACE_HPP
+#define _CHIP8_TRACE_HPP
+
+
+// ------- TRACE Class ------- //
+
+/*
+A container class for the chip8-trace program. It reads a binary trace
+written by DEBUG and prints it in the text log layout.
+*/
+
+class TRACE {
+public:
+  // Trace public functions
+  void initialize(const int argc, const char *argv[]);
+  void run();
+  void finalize();
+
+private:
+  // Trace variables
+  bool ready;
+  std::string trace_path;
+  std::string output_path;
+  std::ifstream input;
+
+  // Trace private functions
+  void parse(const int argc, const char *argv[]);
+  void usage(const std::string& name);
+  bool header();
+  void convert(std::ostream& out);
+};
+
+
+#endif // _CHIP8_TRACE_HPP
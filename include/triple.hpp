@@ -0,0 +1,72 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - triple.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_TRIPLE_HPP
+#define _CHIP8_TRIPLE_HPP
+
+
+// ------- TRIPLE_BUFFER Class ------- //
+
+/*
+A lock-free triple buffer handing values from one writer thread to one
+reader thread. The writer fills back() and publishes it, the reader
+picks up the newest published value with update() and reads front().
+Neither side ever waits, values the reader missed are overwritten.
+*/
+
+template<typename T>
+class TRIPLE_BUFFER {
+public:
+  // Triple buffer writer functions
+  T& back() { return buffers[back_index]; }
+
+  void publish() {
+    // Swap the back buffer with the middle one and mark it fresh
+    back_index = middle.exchange(back_index | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  // Triple buffer reader functions
+  bool update() {
+    // Swap the front buffer with the middle one when it holds a new value
+    if((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+      return false;
+
+    front_index = middle.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  const T& front() { return buffers[front_index]; }
+
+private:
+  static const unsigned int INDEX = 0x3;
+  static const unsigned int FRESH = 0x4;
+
+  // Triple buffer variables, each index is owned by one side
+  std::array<T, 3> buffers;
+  unsigned int back_index = 0;
+  unsigned int front_index = 1;
+  std::atomic<unsigned int> middle{2};
+};
+
+
+#endif // _CHIP8_TRIPLE_HPP
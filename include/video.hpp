@@ -0,0 +1,89 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - video.hpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef _CHIP8_VIDEO_HPP
+#define _CHIP8_VIDEO_HPP
+
+
+// ------- Video Constants ------- //
+
+static const int SCREEN_W = 64;   // CHIP8 screen width in pixels
+static const int SCREEN_H = 32;   // CHIP8 screen height in pixels
+
+
+// ------- RECT Structure ------- //
+
+// An area of the framebuffer in pixels, empty when w or h is 0
+struct RECT {
+  int x;
+  int y;
+  int w;
+  int h;
+
+  bool empty() const { return w <= 0 || h <= 0; }
+
+  void merge(const RECT& area) {
+    // Grow to the bounding box of both areas
+    if(area.empty())
+      return;
+
+    if(empty()) {
+      *this = area;
+      return;
+    }
+
+    const int right = std::max(x + w, area.x + area.w);
+    const int bottom = std::max(y + h, area.y + area.h);
+    x = std::min(x, area.x);
+    y = std::min(y, area.y);
+    w = right - x;
+    h = bottom - y;
+  }
+};
+
+
+// ------- VIDEO Interface ------- //
+
+/*
+The sink SYSTEM presents the CPU framebuffer to, together with the area
+that changed since the previous draw. DISPLAY shows it in an SDL window
+while HEADLESS discards it so no SDL calls are made.
+*/
+
+class VIDEO {
+public:
+  virtual ~VIDEO() {}
+
+  virtual void draw(const Frame& display, const RECT& area) = 0;
+};
+
+
+// ------- HEADLESS Class ------- //
+
+class HEADLESS : public VIDEO {
+public:
+  void draw(const Frame& display, const RECT& area) override {}
+};
+
+
+#endif // _CHIP8_VIDEO_HPP
@@ -0,0 +1,268 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - batch.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- BATCH Class Implementation ------- //
+
+// ------- Batch public functions
+
+void BATCH::initialize(const int argc, const char *argv[]) {
+  ready = false;
+  threads = std::thread::hardware_concurrency();
+  frames = 0;
+  lanes = 0;
+  max_cycles = 0;
+  seed = 0;
+  engine = CPU::ENGINE::INTERPRETER;
+
+  // Read the clock and frame settings without opening a window
+  config.configure();
+
+  // Parse the variable passed to the batch runner
+  parse(argc, argv);
+
+  // Size frames exactly as the window does, carrying the remainder of clock / TIMER_HZ
+  if(frames > 0) {
+    SCHEDULER scheduler;
+    scheduler.initialize(config.getClock(), TIMER_HZ);
+    max_cycles = 0;
+    for(unsigned int frame = 0; frame < frames; frame++)
+      max_cycles += scheduler.next();
+  }
+
+  if(ready)
+    pool.initialize(threads);
+}
+
+
+void BATCH::run() {
+  if(!ready)
+    return;
+
+  // Queue one job per ROM and wait for all of them
+  results.resize(roms.size());
+  for(std::size_t job = 0; job < roms.size(); job++) {
+    if(lanes > 0)
+      pool.submit([this, job] { executeLockstep(job); });
+    else
+      pool.submit([this, job] { execute(job); });
+  }
+
+  pool.wait();
+
+  if(output_path.empty()) {
+    report(std::cout);
+    return;
+  }
+
+  std::ofstream output(output_path);
+  report(output);
+}
+
+
+void BATCH::finalize() {
+  if(ready)
+    pool.finalize();
+}
+
+
+// ------- Batch private functions
+
+void BATCH::parse(const int argc, const char *argv[]) {
+  // Add our arguments to a vector of strings
+  std::vector<std::string> args;
+
+  for(int i = 0; i < argc; i++)
+    args.push_back(argv[i]);
+
+  for(std::size_t n = 1; n < args.size(); n++) {
+    if(!args[n].compare("-h") || !args[n].compare("-H")) {
+      usage(args[0]);
+      return;
+    } else if(!args[n].compare("--cycles") && n + 1 < args.size()) {
+      max_cycles = std::strtoull(args[++n].c_str(), nullptr, 10);
+    } else if(!args[n].compare("--frames") && n + 1 < args.size()) {
+      frames = std::strtoul(args[++n].c_str(), nullptr, 10);
+    } else if(!args[n].compare("--threads") && n + 1 < args.size()) {
+      threads = std::strtoul(args[++n].c_str(), nullptr, 10);
+    } else if(!args[n].compare("--lanes") && n + 1 < args.size()) {
+      lanes = std::strtoul(args[++n].c_str(), nullptr, 10);
+    } else if(!args[n].compare("--seed") && n + 1 < args.size()) {
+      seed = std::strtoull(args[++n].c_str(), nullptr, 10);
+    } else if(!args[n].compare("--output") && n + 1 < args.size()) {
+      output_path = args[++n];
+    } else if(!args[n].compare("--jit")) {
+      engine = CPU::ENGINE::JIT;
+    } else if(!args[n].compare("--threaded")) {
+      engine = CPU::ENGINE::THREADED;
+    } else if(!args[n].compare(0, 1, "-")) {
+      // Catch unknown commands
+      usage(args[0]);
+      return;
+    } else {
+      roms.push_back(args[n]);
+    }
+  }
+
+  // A budget is required since most ROMs never halt
+  if(roms.empty() || (max_cycles == 0 && frames == 0)) {
+    usage(args[0]);
+    return;
+  }
+
+  ready = true;
+}
+
+
+void BATCH::usage(const std::string& name) {
+  std::cerr << "[CHIP8] Usage:\t" << name << " [OPTIONS] <ROM_PATH>..." << std::endl;
+  std::cerr << "[CHIP8] Options:" << std::endl;
+  std::cerr << "\t--cycles <N>\tRun every ROM for N instructions" << std::endl;
+  std::cerr << "\t--frames <N>\tRun every ROM for N 60 Hz frames at APP_CLOCK" << std::endl;
+  std::cerr << "\t--threads <N>\tNumber of worker threads (default: all cores)" << std::endl;
+  std::cerr << "\t--lanes <N>\tRun N copies of every ROM on the lockstep engine" << std::endl;
+  std::cerr << "\t--seed <N>\tSeed the CXNN random numbers (default: 0)" << std::endl;
+  std::cerr << "\t--output <PATH>\tWrite the results to PATH instead of stdout" << std::endl;
+  std::cerr << "\t--jit\t\tUse the JIT engine" << std::endl;
+  std::cerr << "\t--threaded\tUse the threaded code interpreter" << std::endl;
+}
+
+
+void BATCH::execute(const std::size_t& job) {
+  // Every job owns a complete machine so nothing is shared between threads
+  DEBUG debug;
+  debug.setEnabled(false);
+
+  std::unique_ptr<CPU> cpu = std::make_unique<CPU>();
+  cpu->initialize(&debug);
+  cpu->setEngine(engine);
+  cpu->setClock(config.getClock());
+  cpu->setSeed(seed);
+  cpu->open(roms[job], 0x200);
+
+  // Run until the budget is spent, the CPU halts or waits for input
+  const std::uint64_t batch = 0x10000;
+  auto start = std::chrono::steady_clock::now();
+
+  while(!cpu->isHalt() && !cpu->isWaiting() && cpu->getCycles() < max_cycles)
+    cpu->run(std::min(batch, max_cycles - cpu->getCycles()));
+
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+  // Record the final machine state
+  RESULT& result = results[job];
+  result.rom = roms[job];
+  result.cycles = cpu->getCycles();
+  result.registers = cpu->getRegisters();
+  result.i = cpu->getI();
+  result.pc = cpu->getPC();
+  result.hash = hash(cpu->getDisplay());
+  result.seconds = seconds.count();
+  result.lanes = 1;
+  result.vectorized = 0.0;
+  result.halted = cpu->isHalt();
+  result.waiting = cpu->isWaiting();
+
+  cpu->finalize();
+}
+
+
+void BATCH::executeLockstep(const std::size_t& job) {
+  // One LOCKSTEP per job, every lane runs the same ROM
+  std::unique_ptr<LOCKSTEP> machines = std::make_unique<LOCKSTEP>();
+  machines->initialize(lanes, config.getClock());
+  machines->setSeed(seed);
+  machines->open(roms[job], 0x200);
+
+  const std::uint64_t batch = 0x10000;
+  auto start = std::chrono::steady_clock::now();
+
+  while(!machines->isStopped() && machines->getCycles() < max_cycles)
+    machines->run(std::min(batch, max_cycles - machines->getCycles()));
+
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+  // Report the first lane, the others only differ through CXNN and input
+  CPU *cpu = machines->getLane(0);
+  const std::uint64_t total = machines->getVectorized() + machines->getScalar();
+
+  RESULT& result = results[job];
+  result.rom = roms[job];
+  result.cycles = machines->getCycles();
+  result.registers = cpu->getRegisters();
+  result.i = cpu->getI();
+  result.pc = cpu->getPC();
+  result.hash = hash(cpu->getDisplay());
+  result.seconds = seconds.count();
+  result.lanes = lanes;
+  result.vectorized = (total > 0) ? double(machines->getVectorized()) / total : 0.0;
+  result.halted = cpu->isHalt();
+  result.waiting = cpu->isWaiting();
+
+  machines->finalize();
+}
+
+
+void BATCH::report(std::ostream& out) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+
+  // Write one JSON record per ROM in command line order
+  for(const RESULT& result : results) {
+    Json::Value record;
+    record["rom"] = result.rom;
+    record["cycles"] = Json::UInt64(result.cycles);
+    record["seconds"] = result.seconds;
+    record["lanes"] = result.lanes;
+    record["cycles_per_second"] = (result.seconds > 0) ? result.cycles * result.lanes / result.seconds : 0.0;
+    if(lanes > 0)
+      record["vectorized"] = result.vectorized;
+    record["halted"] = result.halted;
+    record["waiting"] = result.waiting;
+    record["pc"] = result.pc;
+    record["i"] = result.i;
+
+    for(const Byte& reg : result.registers)
+      record["registers"].append(reg);
+
+    std::stringstream hex;
+    hex << std::hex << std::setfill('0') << std::setw(8) << result.hash;
+    record["framebuffer"] = hex.str();
+
+    out << Json::writeString(builder, record) << std::endl;
+  }
+}
+
+
+std::uint32_t BATCH::hash(const Frame& display) {
+  // 32 bit FNV-1a over the framebuffer rows, most significant byte first
+  std::uint32_t value = 2166136261u;
+  for(const std::uint64_t& row : display) {
+    for(int shift = 56; shift >= 0; shift -= 8)
+      value = (value ^ Byte(row >> shift)) * 16777619u;
+  }
+
+  return value;
+}
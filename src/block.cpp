@@ -0,0 +1,158 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - block.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+//------- Basic Block Cache Implementation ------- //
+
+unsigned int CPU::runBlock(const unsigned int& budget) {
+  // Translate the basic block at PC on first use, jumps past 0xFFF wrap around
+  pc &= MEM_SIZE - 1;
+  const BLOCK *block = blocks[pc].get();
+  if(block == nullptr)
+    block = translate(pc);
+
+  const INSTRUCTION *const *code = block->code.data();
+  const std::size_t size = std::min<std::size_t>(block->code.size(), budget);
+  const unsigned int epoch = flushes;
+  unsigned int executed = 0;
+
+  // Run the block until it ends, halts, waits or is overwritten
+  while(executed < size) {
+    instr = code[executed++];
+    opcode = instr->opcode;
+
+    // Log CPU Status
+    trace();
+    profile();
+
+    execute();                  // Execute
+    timer.update(1);
+
+    if(halt || waiting || epoch != flushes)
+      break;
+  }
+
+  return executed;
+}
+
+
+const CPU::BLOCK *CPU::translate(const Word& addr) {
+  std::unique_ptr<BLOCK> block = std::make_unique<BLOCK>();
+  block->start = addr;
+  block->end = addr;
+
+  // Decode straight-line instructions up to the first branch
+  while(block->end + 1 < MEM_SIZE && block->code.size() < BLOCK_MAX) {
+    const INSTRUCTION *op = decode(block->end);
+    block->code.push_back(op);
+    block->end += 2;
+
+    if(endsBlock(op))
+      break;
+  }
+
+  // Nothing fits at 0xFFF, the block halts on the stand in opcode
+  if(block->code.empty())
+    block->code.push_back(&truncated);
+
+  // Mark the bytes the block was translated from
+  for(Word n = block->start; n < block->end; n++)
+    block_map[n] = true;
+
+  blocks[addr] = std::move(block);
+  return blocks[addr].get();
+}
+
+
+void CPU::clearBlocks() {
+  // Drop every block (reset and ROM load)
+  for(std::unique_ptr<BLOCK>& block : blocks)
+    block.reset();
+
+  block_map.reset();
+  jit.reset();
+  ++flushes;
+}
+
+
+void CPU::flushBlocks(const Word& addr) {
+  block_map.reset();
+
+  // Drop the blocks covering addr and remap the remaining ones
+  for(std::unique_ptr<BLOCK>& block : blocks) {
+    if(!block)
+      continue;
+
+    if(block->start <= addr && addr < block->end) {
+      block.reset();
+      continue;
+    }
+
+    for(Word n = block->start; n < block->end; n++)
+      block_map[n] = true;
+  }
+
+  ++flushes;
+}
+
+
+void CPU::invalidate(const Word& addr) {
+  // Drop the cached instructions that overlap the written byte
+  if(addr >= MEM_SIZE)
+    return;
+
+  icache[addr] = nullptr;
+  if(addr > 0)
+    icache[addr - 1] = nullptr;
+
+  // Only search the blocks when the byte was translated
+  if(block_map[addr])
+    flushBlocks(addr);
+
+  jit.invalidate(addr);
+}
+
+
+bool CPU::endsBlock(const INSTRUCTION *op) {
+  // Control flow, key waits and unknown opcodes end a basic block
+  switch(op->id) {
+    case OP_NONE:
+    case OP_SYS:
+    case OP_RET:
+    case OP_JMP:
+    case OP_CAL:
+    case OP_SI:
+    case OP_SNEN:
+    case OP_SE:
+    case OP_SNEY:
+    case OP_JPA:
+    case OP_SKP:
+    case OP_SKNP:
+    case OP_LDK:
+      return true;
+    default:
+      return false;
+  }
+}
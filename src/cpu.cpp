@@ -26,23 +26,40 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 
 // ------- CPU public functions
 
-void CPU::initialize(DISPLAY *d, DEBUG *dbg) {
-  window = d;
+void CPU::initialize(DEBUG *dbg) {
   debug = dbg;
+  profiler = nullptr;
+  flushes = 0;
+  engine = ENGINE::INTERPRETER;
+  differential = false;
+  seed = 0;
+  timer.setClock(CLOCK_HZ);
   reset();  //
 }
 
 
-void CPU::update() {
-  fetch();                      // Fetch
-  decode();                     // Decode
+unsigned int CPU::run(const unsigned int& cycles) {
+  unsigned int executed = 0;
 
-  // Log CPU Status
-  debug->log_cpu_state(opcode, registers, i, pc, sp);
+  // Run until the budget is spent or the CPU halts or waits for a key
+  while(executed < cycles && !halt) {
+    const unsigned int done = dispatch(cycles - executed);
+    executed += done;
+
+    // Every engine runs at least one instruction, stop rather than spin
+    if(done == 0 && !halt && !waiting) {
+      std::cerr << "[CHIP8] CPU stalled at PC " << pc << std::endl;
+      halt = true;
+    }
+
+    if(waiting) {
+      // The CPU spins on FX0A for the rest of the budget
+      timer.update(cycles - executed);
+      executed = cycles;
+    }
+  }
 
-  execute();                    // Execute
-  --delay_timer;
-  --sound_timer;
+  return executed;
 }
 
 
@@ -56,219 +73,389 @@ void CPU::reset() {
   pc = 0x200;
   sp = 0;
   stack.fill(0);
+  icache.fill(nullptr);
+  clearBlocks();
   display.fill(0);
   key.fill(0);
 
-  delay_timer = 0;
-  sound_timer = 0;
+  timer.reset();
+  rng.seed(seed);
 
   opcode = 0;
 
   halt = false;
+  waiting = false;
+  dirty = RECT{};
 }
 
 
 void CPU::open(const std::string& path, const Word& offset) {
   memory.open(path, offset);
+  icache.fill(nullptr);
+  clearBlocks();
   initialized = true;
 }
 
 
+void CPU::save(SNAPSHOT& state) {
+  // Fill in every field, the snapshot is written to disk as is
+  std::copy(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4, state.magic);
+  state.version = SNAPSHOT_VERSION;
+  state.size = sizeof(SNAPSHOT);
+
+  state.clock = timer.getClock();
+  state.accumulator = std::uint32_t(timer.getAccumulator());   // Always below clock
+  state.presses = 0;
+  state.elapsed = timer.getElapsed();
+
+  state.seed = seed;
+  state.random = rng.getState();
+
+  state.display = display;
+  state.memory = memory.getData();
+  state.stack = stack;
+  state.i = i;
+  state.pc = pc;
+  state.registers = registers;
+  state.key = key;
+  state.sp = sp;
+  state.delay = timer.getDelay();
+  state.sound = timer.getSound();
+  state.flags = (halt ? SNAPSHOT_HALT : 0) | (waiting ? SNAPSHOT_WAITING : 0);
+}
+
+
+bool CPU::load(const SNAPSHOT& state) {
+  if(!state.valid()) {
+    std::cerr << "[CHIP8] Save state does not match version " << SNAPSHOT_VERSION << std::endl;
+    return false;
+  }
+
+  timer.restore(state.clock, state.accumulator, state.elapsed);
+  timer.setDelay(state.delay);
+  timer.setSound(state.sound);
+
+  seed = state.seed;
+  rng.setState(state.random);
+
+  display = state.display;
+  memory.setData(state.memory);
+  stack = state.stack;
+  i = state.i & (MEM_SIZE - 1);
+  pc = state.pc & (MEM_SIZE - 1);
+  registers = state.registers;
+  key = state.key;
+  sp = std::min<Byte>(state.sp, 16);
+  halt = (state.flags & SNAPSHOT_HALT) != 0;
+  waiting = (state.flags & SNAPSHOT_WAITING) != 0;
+  opcode = 0;
+  initialized = true;
+
+  // Code may differ from what was decoded or translated so drop all of it
+  icache.fill(nullptr);
+  clearBlocks();
+
+  // The whole screen has to be shown again
+  dirty = RECT{0, 0, SCREEN_W, SCREEN_H};
+  return true;
+}
+
+
+void CPU::finalize() {
+  // Release the JIT code buffer
+  if(engine == ENGINE::JIT)
+    jit.finalize();
+}
+
+
 void CPU::setKey(const int& n) {
   key.fill(0);
   key[n] = 1;
 }
 
 
+void CPU::setEngine(const ENGINE& e) {
+  if(e == ENGINE::JIT && !jit.initialize()) {
+    std::cerr << "[CHIP8] JIT unavailable on this host, using the interpreter." << std::endl;
+    engine = ENGINE::INTERPRETER;
+    return;
+  }
+
+  engine = e;
+}
+
+
 // ------- CPU private functions
 
-void CPU::fetch() {
-  // Fetch the next instruction
-  Byte msb = memory_read(pc);
-  Byte lsb = memory_read(pc + 1);
+Word CPU::fetch(const Word& addr) {
+  // Fetch the instruction at addr
+  Byte msb = memory_read(addr);
+  Byte lsb = memory_read(addr + 1);
 
   // Assemble the opcode
-  opcode = (msb << 8) | lsb;
+  return (msb << 8) | lsb;
 }
 
 
-void CPU::decode() {
+const CPU::INSTRUCTION *CPU::decode(const Word& addr) {
+  // Skip the memory fetch when the instruction is already decoded
+  const Word at = addr & (MEM_SIZE - 1);
+  if(at == MEM_SIZE - 1)
+    return &truncated;
+
+  const INSTRUCTION *op = icache[at];
+  if(op != nullptr)
+    return op;
+
+  // Look up the pre-decoded handler and operands and cache them
+  op = &decode_table[fetch(at)];
+  icache[at] = op;
+  return op;
+}
+
+
+void CPU::execute() {
+  // Execute the relevant opcode function
+  (this->*instr->func)();
+}
+
+
+void CPU::step() {
+  // Interpret the single instruction at PC, jumps past 0xFFF wrap around
+  pc &= MEM_SIZE - 1;
+  instr = decode(pc);
+  opcode = instr->opcode;
+
+  // Log CPU Status
+  trace();
+  profile();
+
+  execute();
+  timer.update(1);
+}
+
+
+unsigned int CPU::dispatch(const unsigned int& budget) {
+  // Run the next stretch of instructions on the selected engine
+  switch(engine) {
+    case ENGINE::JIT:
+      {
+        const unsigned int executed = runNative(budget);
+        if(executed > 0)
+          return executed;
+      }
+      return runBlock(budget);
+    case ENGINE::THREADED:
+      return runThreaded(budget);
+    default:
+      return runBlock(budget);
+  }
+}
+
+
+unsigned int CPU::runNative(const unsigned int& budget) {
+  // Fall back to the interpreter when nothing at PC was translated or
+  // the translated block does not fit the budget
+  pc &= MEM_SIZE - 1;
+  const JIT::BLOCK *native = jit.lookup(memory, pc);
+  if(native->func == nullptr || native->count > budget)
+    return 0;
+
+  // Log CPU Status at block entry
+  opcode = decode(pc)->opcode;
+  trace();
+
+  JIT::CONTEXT ctx;
+  ctx.registers = registers;
+  ctx.i = i;
+  ctx.pc = pc;
+  native->func(&ctx);
+
+  if(differential) {
+    // Replay the block through the interpreter and compare the results
+    const Word start = pc;
+    for(unsigned int n = 0; n < native->count; n++)
+      step();
+
+    if(ctx.registers != registers || ctx.i != i || ctx.pc != pc) {
+      std::cerr << "[CHIP8] JIT mismatch in block 0x" << std::hex << start << std::endl;
+      for(unsigned int n = 0; n < 16; n++) {
+        std::cerr << "\tV" << n << " JIT:0x" << unsigned(ctx.registers[n])
+        << " INT:0x" << unsigned(registers[n]) << std::endl;
+      }
+      std::cerr << "\tI JIT:0x" << ctx.i << " INT:0x" << i << std::endl;
+      std::cerr << "\tPC JIT:0x" << ctx.pc << " INT:0x" << pc << std::dec << std::endl;
+      halt = true;
+    }
+    return native->count;
+  }
+
+  // Native code does not count, attribute the block instruction by instruction
+  if(profiler != nullptr) {
+    for(Word addr = native->start; addr < native->end; addr += 2)
+      profiler->count(decode(addr)->id, addr);
+  }
+
+  registers = ctx.registers;
+  i = ctx.i;
+  pc = ctx.pc;
+  timer.update(native->count);
+  return native->count;
+}
+
+
+// ------- CPU decode table
+
+constexpr CPU::OPID CPU::decodeId(const Word& op) {
   // Opcode switch to determine which operation
-  switch(opcode & 0xF000) {
+  switch(op & 0xF000) {
     case 0x0000:
-      switch(opcode & 0xFF) {
+      switch(op & 0xFF) {
         case 0x00:
-          opfunc = &CPU::opcode_nop;
-          break;
+          return OP_NOP;
         case 0xE0:
-          opfunc = &CPU::opcode_cls;
-          break;
+          return OP_CLS;
         case 0xEE:
-          opfunc = &CPU::opcode_ret;
-          break;
+          return OP_RET;
         default:
-          opfunc = &CPU::opcode_sys;
-          break;
+          return OP_SYS;
       };
-      break;
     case 0x1000:
-      opfunc = &CPU::opcode_jmp;
-      break;
+      return OP_JMP;
     case 0x2000:
-      opfunc = &CPU::opcode_cal;
-      break;
+      return OP_CAL;
     case 0x3000:
-      opfunc = &CPU::opcode_si;
-      break;
+      return OP_SI;
     case 0x4000:
-      opfunc = &CPU::opcode_snen;
-      break;
+      return OP_SNEN;
     case 0x5000:
-      {
-        if(opcode & 0xF)
-          opfunc = &CPU::opcode_none;
-        else
-          opfunc = &CPU::opcode_se;
-      }
-      break;
+      return (op & 0xF) ? OP_NONE : OP_SE;
     case 0x6000:
-      opfunc = &CPU::opcode_ldn;
-      break;
+      return OP_LDN;
     case 0x7000:
-      opfunc = &CPU::opcode_adn;
-      break;
+      return OP_ADN;
     case 0x8000:
-      switch(opcode & 0xF) {
+      switch(op & 0xF) {
         case 0x0:
-          opfunc = &CPU::opcode_ldx;
-          break;
+          return OP_LDX;
         case 0x1:
-          opfunc = &CPU::opcode_orx;
-          break;
+          return OP_ORX;
         case 0x2:
-          opfunc = &CPU::opcode_anx;
-          break;
+          return OP_ANX;
         case 0x3:
-          opfunc = &CPU::opcode_xor;
-          break;
+          return OP_XOR;
         case 0x4:
-          opfunc = &CPU::opcode_adc;
-          break;
+          return OP_ADC;
         case 0x5:
-          opfunc = &CPU::opcode_sub;
-          break;
+          return OP_SUB;
         case 0x6:
-          opfunc = &CPU::opcode_srh;
-          break;
+          return OP_SRH;
         case 0x7:
-          opfunc = &CPU::opcode_subn;
-          break;
+          return OP_SUBN;
         case 0xE:
-          opfunc = &CPU::opcode_shl;
-          break;
+          return OP_SHL;
         default:
-          opfunc = &CPU::opcode_none;
-          break;
+          return OP_NONE;
       };
-      break;
     case 0x9000:
-      {
-        if(opcode & 0xF)
-          opfunc = &CPU::opcode_none;
-        else
-          opfunc = &CPU::opcode_sney;
-      }
-      break;
+      return (op & 0xF) ? OP_NONE : OP_SNEY;
     case 0xA000:
-      opfunc = &CPU::opcode_ldi;
-      break;
+      return OP_LDI;
     case 0xB000:
-      opfunc = &CPU::opcode_jpa;
-      break;
+      return OP_JPA;
     case 0xC000:
-      opfunc = &CPU::opcode_rnd;
-      break;
+      return OP_RND;
     case 0xD000:
-      opfunc = &CPU::opcode_drw;
-      break;
+      return OP_DRW;
     case 0xE000:
-      switch(opcode & 0xFF) {
+      switch(op & 0xFF) {
         case 0x9E:
-          opfunc = &CPU::opcode_skp;
-          break;
+          return OP_SKP;
         case 0xA1:
-          opfunc = &CPU::opcode_sknp;
-          break;
+          return OP_SKNP;
         default:
-          opfunc = &CPU::opcode_none;
-          break;
+          return OP_NONE;
       };
-      break;
     case 0xF000:
-      switch(opcode & 0xFF) {
+      switch(op & 0xFF) {
         case 0x07:
-          opfunc = &CPU::opcode_lxd;
-          break;
+          return OP_LXD;
         case 0x0A:
-          opfunc = &CPU::opcode_ldk;
-          break;
+          return OP_LDK;
         case 0x15:
-          opfunc = &CPU::opcode_ldt;
-          break;
+          return OP_LDT;
         case 0x18:
-          opfunc = &CPU::opcode_lsx;
-          break;
+          return OP_LSX;
         case 0x1E:
-          opfunc = &CPU::opcode_adi;
-          break;
+          return OP_ADI;
         case 0x29:
-          opfunc = &CPU::opcode_lds;
-          break;
+          return OP_LDS;
         case 0x33:
-          opfunc = &CPU::opcode_ldb;
-          break;
+          return OP_LDB;
         case 0x55:
-          opfunc = &CPU::opcode_ldm;
-          break;
+          return OP_LDM;
         case 0x65:
-          opfunc = &CPU::opcode_rdx;
-          break;
+          return OP_RDX;
         default:
-          opfunc = &CPU::opcode_none;
-          break;
+          return OP_NONE;
       };
-      break;
     default:
-      opfunc = &CPU::opcode_none;
-      break;
-    }
+      return OP_NONE;
+  }
 }
 
 
-void CPU::execute() {
-  // Execute the relevant opcode function
-  (this->*opfunc)();
+constexpr std::array<OPFUNC, CPU::OP_COUNT> CPU::handlers = {
+  &CPU::opcode_none, &CPU::opcode_nop, &CPU::opcode_sys, &CPU::opcode_cls,
+  &CPU::opcode_ret, &CPU::opcode_jmp, &CPU::opcode_cal, &CPU::opcode_si,
+  &CPU::opcode_snen, &CPU::opcode_se, &CPU::opcode_ldn, &CPU::opcode_adn,
+  &CPU::opcode_ldx, &CPU::opcode_orx, &CPU::opcode_anx, &CPU::opcode_xor,
+  &CPU::opcode_adc, &CPU::opcode_sub, &CPU::opcode_srh, &CPU::opcode_subn,
+  &CPU::opcode_shl, &CPU::opcode_sney, &CPU::opcode_ldi, &CPU::opcode_jpa,
+  &CPU::opcode_rnd, &CPU::opcode_drw, &CPU::opcode_skp, &CPU::opcode_sknp,
+  &CPU::opcode_lxd, &CPU::opcode_ldk, &CPU::opcode_ldt, &CPU::opcode_lsx,
+  &CPU::opcode_adi, &CPU::opcode_lds, &CPU::opcode_ldb, &CPU::opcode_ldm,
+  &CPU::opcode_rdx
+};
+
+
+const std::array<const char*, CPU::OP_COUNT> CPU::mnemonics = {
+  "????", "0000 NOP", "0NNN SYS", "00E0 CLS", "00EE RET", "1NNN JP",
+  "2NNN CALL", "3XNN SE", "4XNN SNE", "5XY0 SE", "6XNN LD", "7XNN ADD",
+  "8XY0 LD", "8XY1 OR", "8XY2 AND", "8XY3 XOR", "8XY4 ADD", "8XY5 SUB",
+  "8XY6 SHR", "8XY7 SUBN", "8XYE SHL", "9XY0 SNE", "ANNN LD I", "BNNN JP V0",
+  "CXNN RND", "DXYN DRW", "EX9E SKP", "EXA1 SKNP", "FX07 LD DT", "FX0A LD K",
+  "FX15 LD DT", "FX18 LD ST", "FX1E ADD I", "FX29 LD F", "FX33 LD B",
+  "FX55 LD [I]", "FX65 LD VX"
+};
+
+
+const char *CPU::describe(const Byte& id) {
+  // Mnemonic of an opcode identifier for reports
+  return (id < OP_COUNT) ? mnemonics[id] : mnemonics[OP_NONE];
 }
 
 
-const Byte& CPU::memory_read(const Word& addr) {
-  // Wrapper to log memory read data
-  debug->log_mem_read(addr, memory.read(addr));
-  return memory.read(addr);
-}
+constexpr std::array<CPU::INSTRUCTION, 0x10000> CPU::buildDecodeTable() {
+  std::array<INSTRUCTION, 0x10000> table{};
 
+  // Decode every possible opcode once and extract its operands
+  for(unsigned int op = 0; op < table.size(); op++) {
+    INSTRUCTION& entry = table[op];
+    entry.id = decodeId(op);
+    entry.func = handlers[entry.id];
+    entry.opcode = op;
+    entry.nnn = op & 0x0FFF;
+    entry.x = (op & 0x0F00) >> 8;
+    entry.y = (op & 0x00F0) >> 4;
+    entry.n = op & 0x000F;
+    entry.nn = op & 0x00FF;
+  }
 
-void CPU::memory_write(const Word& addr, const Byte& value) {
-  // Wrapper to log memory write data
-  debug->log_mem_write(addr, value);
-  memory.write(addr, value);
+  return table;
 }
 
 
-Byte CPU::randomNumber(const Byte& l, const Byte& h) {
-  std::random_device device;  // obtain random number from device
-  std::mt19937 gen(device()); // seed the generator
-  std::uniform_int_distribution<> distr(l, h); // define the range
+constexpr std::array<CPU::INSTRUCTION, 0x10000> CPU::decode_table = CPU::buildDecodeTable();
 
-  return distr(gen);
-}
+const CPU::INSTRUCTION CPU::truncated = { &CPU::opcode_none, 0, 0, 0, 0, 0, 0, CPU::OP_NONE };
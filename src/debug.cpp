@@ -32,64 +32,94 @@ void DEBUG::start() {
   if(!enabled)
     return;
 
-  // Open the log file and print the debug header
-  output.open(log_path, std::ofstream::out | std::ofstream::app);
-
-  for(int i = 0; i < 50; i++) output << "#";
-  output << " DEBUGGING ";
-  for(int i = 0; i < 51; i++) output << "#";   // Inequality makes me unhappy
-  output << std::endl;
-}
+  // Open the trace file and write the header
+  output.open(log_path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+  if(!output.is_open()) {
+    std::cerr << "[CHIP8] Unable to open trace file: " << log_path << std::endl;
+    enabled = false;
+    return;
+  }
 
+  HEADER header;
+  std::copy(TRACE_MAGIC, TRACE_MAGIC + 4, header.magic);
+  header.version = TRACE_VERSION;
+  header.size = sizeof(RECORD);
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
 
-void DEBUG::stop() {
-  // Print out our footer and close the log file
-  for(int i = 0; i < 112; i++)
-    output << "#";
-  output << std::endl << std::endl;
-  output.close();
+  // Start the thread writing the trace out
+  ring = std::make_unique<RING<RECORD, TRACE_RING>>();
+  writing = true;
+  writer = std::thread(&DEBUG::drain, this);
 }
 
 
-void DEBUG::log_cpu_state(const Word& opcode, const std::array<Byte, 16>& registers, const Word& i, const Word& pc, const Byte& sp) {
-  if(!enabled)
+void DEBUG::stop() {
+  if(!writer.joinable())
     return;
 
-  if(output.is_open()) {
-    // First print the opcode
-    output << "| " << std::hex << std::setfill('0') << std::setw(4) << unsigned(opcode);
+  // Let the writer empty the ring and close the trace file
+  writing = false;
+  writer.join();
+  output.close();
+  ring.reset();
+}
 
-    // Print out all the register values
-    for(unsigned int n = 0; n < registers.size(); n++)
-      output << " |" << n << ":0x" << std::hex << std::setw(2) << unsigned(registers[n]);
 
-    // Print out the i reg, pc and sp and flush the buffer
-    output << " |I:0x" << std::hex << std::setw(4) << unsigned(i) <<
-    " |PC:0x" << std::hex << std::setw(4) << unsigned(pc) <<
-    " |SP:" << std::hex << std::setw(4) << unsigned(sp) << " |"<< std::endl;
+void DEBUG::format(std::ostream& out, const RECORD& record) {
+  out << std::hex << std::setfill('0');
+
+  switch(record.type) {
+    case TRACE_CPU:
+      // First print the opcode
+      out << "| " << std::setw(4) << unsigned(record.opcode);
+
+      // Print out all the register values
+      for(unsigned int n = 0; n < record.registers.size(); n++)
+        out << " |" << n << ":0x" << std::setw(2) << unsigned(record.registers[n]);
+
+      // Print out the i reg, pc and sp
+      out << " |I:0x" << std::setw(4) << unsigned(record.i) <<
+      " |PC:0x" << std::setw(4) << unsigned(record.pc) <<
+      " |SP:" << std::setw(4) << unsigned(record.sp) << " |" << '\n';
+      break;
+    case TRACE_READ:
+      out << "| MEM-READ: 0x" << std::setw(4) << unsigned(record.opcode) <<
+      " | FOUND: 0x" << std::setw(2) << unsigned(record.i) << '\n';
+      break;
+    case TRACE_WRITE:
+      out << "| MEM-WRITE: 0x" << std::setw(4) << unsigned(record.opcode) <<
+      " | WROTE: 0x" << std::setw(2) << unsigned(record.i) << '\n';
+      break;
+    default:
+      out << "| UNKNOWN RECORD: " << unsigned(record.type) << '\n';
+      break;
   }
 }
 
 
-void DEBUG::log_mem_read(const Word& addr, const Byte& value) {
-  if(!enabled)
-    return;
+// ------- Debug private functions
 
-  if(output.is_open()) {
-    // Print output from the memory read instruction
-    output << "| MEM-READ: 0x" << std::hex << std::setw(4) << unsigned(addr) <<
-    " | FOUND: 0x" << std::hex << std::setw(2) << unsigned(value) << std::endl;
-  }
+void DEBUG::push(const RECORD& record) {
+  // Never drop a record, wait for the writer when the ring is full
+  while(!ring->push(record))
+    std::this_thread::yield();
 }
 
 
-void DEBUG::log_mem_write(const Word& addr, const Byte& value) {
-  if(!enabled)
-    return;
+void DEBUG::drain() {
+  std::vector<RECORD> block(TRACE_BLOCK);
+
+  // Write whole blocks until stopped and the ring is empty
+  while(true) {
+    const bool stopping = !writing;
+    const std::size_t count = ring->pop(block.data(), block.size());
 
-  if(output.is_open()) {
-    // Print output from the memory write instruction
-    output << "| MEM-WRITE: 0x" << std::hex << std::setw(4) << unsigned(addr) <<
-    " | WROTE: 0x" << std::hex << std::setw(2) << unsigned(value) << std::endl;
+    if(count > 0) {
+      output.write(reinterpret_cast<const char*>(block.data()), count * sizeof(RECORD));
+    } else if(stopping) {
+      break;
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
   }
 }
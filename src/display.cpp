@@ -28,12 +28,20 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 
 // Display public functions
 
-void DISPLAY::initialize() {
+void DISPLAY::configure() {
+  initialized = false;
+
   // Initialize the application to default settings
   setDefault();
 
   // Initialize the configuration if Present
   setConfig();
+}
+
+
+void DISPLAY::initialize() {
+  // Read the settings before creating the window
+  configure();
 
   // Initialize the window
   std::string title = _APP_NAME " - " _APP_VERSION;
@@ -51,48 +59,64 @@ void DISPLAY::initialize() {
     return;
   }
 
-  // Configure colours
-  SDL_SetRenderDrawColor(render, 0, 0, 0, 0);
-  SDL_RenderClear(render);
-  SDL_SetRenderDrawColor(render, pixel_r, pixel_g, pixel_b, pixel_a);
+  // Initialize the screen texture
+  texture = SDL_CreateTexture(render, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_W, SCREEN_H);
+  if(texture == nullptr) {
+    std::cerr << "[CHIP8] SDL_TEXTURE_ERROR: " << SDL_GetError() << std::endl;
+    SDL_DestroyRenderer(render);
+    SDL_DestroyWindow(window);
+    return;
+  }
 
-  SDL_RenderPresent(render);
+  // Pixels are opaque like the rects they replace
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+
+  screen.x = 0;
+  screen.y = 0;
+  screen.w = SCREEN_W * pixel_w;
+  screen.h = SCREEN_H * pixel_h;
+
+  // Configure colours
+  palette[0] = 0xFF000000;
+  palette[1] = ((pixel_a & 0xFF) << 24) | ((pixel_r & 0xFF) << 16) | ((pixel_g & 0xFF) << 8) | (pixel_b & 0xFF);
 
   initialized = true;
+
+  // Start from a blank screen, later draws only upload what changed
+  Frame blank;
+  blank.fill(0);
+  draw(blank, RECT{0, 0, SCREEN_W, SCREEN_H});
 }
 
 
-void DISPLAY::draw(const std::array<Byte, 2048>& display) {
-  if(!initialized)
+void DISPLAY::draw(const Frame& display, const RECT& area) {
+  if(!initialized || area.empty())
     return;
 
-  // Clear the display
-  SDL_SetRenderDrawColor(render, 0, 0, 0, 0);
-  SDL_RenderClear(render);
-  SDL_SetRenderDrawColor(render, pixel_r, pixel_g, pixel_b, pixel_a);
+  // Expand the changed area of the frame through the palette
+  for(int y = 0; y < area.h; y++) {
+    const std::uint64_t row = display[area.y + y];
+    std::uint32_t *line = &pixels[y * area.w];
+
+    for(int x = 0; x < area.w; x++)
+      line[x] = palette[(row >> (63 - area.x - x)) & 1];
+  }
 
-  // Draw pixel's to the screen
-  for(unsigned int pos = 0; pos < 2048; pos++) {
-    if(display[pos] == 1) {
-      // Calculate the xy coordinates
-      unsigned int x = pos % 64;
-      unsigned int y = pos / 64;
-
-      // Generate a rect to represent our pixel
-      SDL_Rect rect;
-      rect.w = pixel_w;
-      rect.h = pixel_h;
-      rect.y = y * rect.h;
-      rect.x = x * rect.w;
-
-
-      // Draw to the render and present to the window
-      SDL_RenderFillRect(render, &rect);
-      SDL_RenderDrawRect(render, &rect);
-    }
+  SDL_Rect rect;
+  rect.x = area.x;
+  rect.y = area.y;
+  rect.w = area.w;
+  rect.h = area.h;
+
+  if(SDL_UpdateTexture(texture, &rect, pixels.data(), area.w * sizeof(std::uint32_t)) != 0) {
+    std::cerr << "[CHIP8] SDL_TEXTURE_ERROR: " << SDL_GetError() << std::endl;
+    return;
   }
 
-  // Present the updated screen and set our last display var
+  // Scale the texture to the window and present it
+  SDL_SetRenderDrawColor(render, 0, 0, 0, 0);
+  SDL_RenderClear(render);
+  SDL_RenderCopy(render, texture, nullptr, &screen);
   SDL_RenderPresent(render);
 }
 
@@ -112,6 +136,7 @@ void DISPLAY::finalize() {
     return;
 
   initialized = false;
+  SDL_DestroyTexture(texture);
   SDL_DestroyRenderer(render);
   SDL_DestroyWindow(window);
 }
@@ -121,7 +146,7 @@ void DISPLAY::finalize() {
 
 void DISPLAY::setDefault() {
   // These are the default display configuration settings
-  app_delay = 1;
+  app_clock = CLOCK_HZ;
   app_w = 320;
   app_h = 640;
   pixel_h = 10;
@@ -142,9 +167,16 @@ void DISPLAY::setConfig() {
     in_stream >> config;
     in_stream.close();
 
-    // Update the display variables where a valid field is present
+    // Frames are sized and paced from APP_CLOCK, the older settings are ignored
     if(!config["APP_DELAY"].empty())
-      app_delay = config["APP_DELAY"].asFloat();
+      std::cerr << "[CHIP8] APP_DELAY is deprecated and ignored, set APP_CLOCK instead" << std::endl;
+
+    if(!config["APP_IPF"].empty())
+      std::cerr << "[CHIP8] APP_IPF is deprecated and ignored, set APP_CLOCK instead" << std::endl;
+
+    // Update the display variables where a valid field is present
+    if(!config["APP_CLOCK"].empty())
+      app_clock = config["APP_CLOCK"].asUInt();
 
     if(!config["APP_W"].empty())
       app_w = config["APP_W"].asUInt();
@@ -0,0 +1,509 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - jit.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+
+// ------- JIT Constants ------- //
+
+// Host registers handed out to CHIP8 registers. rax is scratch, rdi holds
+// the CONTEXT pointer and rbx, rbp, r12-r15 must be preserved.
+static const int jit_pool[] = { 1, 2, 6, 8, 9, 10, 11, 3, 5, 12, 13, 14, 15 };
+static const unsigned int JIT_POOL = sizeof(jit_pool) / sizeof(jit_pool[0]);
+
+static const int JIT_RAX = 0;
+static const Byte JIT_OP_ADD = 0x01;   // add r/m32, r32
+static const Byte JIT_OP_OR  = 0x09;   // or  r/m32, r32
+static const Byte JIT_OP_AND = 0x21;   // and r/m32, r32
+static const Byte JIT_OP_SUB = 0x29;   // sub r/m32, r32
+static const Byte JIT_OP_XOR = 0x31;   // xor r/m32, r32
+static const Byte JIT_OP_CMP = 0x39;   // cmp r/m32, r32
+static const Byte JIT_OP_MOV = 0x89;   // mov r/m32, r32
+static const Byte JIT_EXT_ADD = 0;     // 81 /0 and C1 /4 extensions
+static const Byte JIT_EXT_AND = 4;
+static const Byte JIT_EXT_SHL = 4;
+static const Byte JIT_EXT_SHR = 5;
+
+
+// ------- JIT helper functions ------- //
+
+static bool jit_saved(const int& reg) {
+  // Callee saved registers need to be pushed before use
+  return reg == 3 || reg == 5 || reg >= 12;
+}
+
+
+static bool jit_operands(const Word& op, std::uint32_t& mask) {
+  // Collect the registers an opcode touches (bit 16 is I), false when
+  // the opcode is not translated
+  const std::uint32_t x = 1 << ((op & 0x0F00) >> 8);
+  const std::uint32_t y = 1 << ((op & 0x00F0) >> 4);
+  const std::uint32_t f = 1 << 0xF;
+  const std::uint32_t i = 1 << 16;
+
+  switch(op & 0xF000) {
+    case 0x1000:
+      mask = 0;
+      return true;
+    case 0x6000:
+    case 0x7000:
+      mask = x;
+      return true;
+    case 0x8000:
+      switch(op & 0xF) {
+        case 0x0:
+        case 0x1:
+        case 0x2:
+        case 0x3:
+          mask = x | y;
+          return true;
+        case 0x4:
+        case 0x5:
+        case 0x7:
+          mask = x | y | f;
+          return true;
+        case 0x6:
+        case 0xE:
+          mask = x | f;
+          return true;
+        default:
+          return false;
+      };
+    case 0xA000:
+      mask = i;
+      return true;
+    case 0xF000:
+      if((op & 0xFF) == 0x1E || (op & 0xFF) == 0x29) {
+        mask = x | i;
+        return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+
+// ------- JIT Class Implementation ------- //
+
+// ------- JIT public functions
+
+bool JIT::initialize() {
+  initialized = false;
+  buffer = nullptr;
+  reset();
+
+#ifdef JIT_SUPPORTED
+  // Reserve the executable memory for translated blocks
+  void *memory = mmap(nullptr, JIT_BUFFER, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(memory == MAP_FAILED) {
+    std::cerr << "[CHIP8] JIT_MMAP_ERROR: unable to allocate executable memory" << std::endl;
+    return false;
+  }
+
+  buffer = static_cast<Byte*>(memory);
+  initialized = true;
+#endif
+
+  return initialized;
+}
+
+
+void JIT::finalize() {
+  if(!initialized)
+    return;
+
+  reset();
+  initialized = false;
+
+#ifdef JIT_SUPPORTED
+  munmap(buffer, JIT_BUFFER);
+#endif
+  buffer = nullptr;
+}
+
+
+void JIT::reset() {
+  // Drop every translated block and recycle the code buffer
+  for(std::unique_ptr<BLOCK>& block : blocks)
+    block.reset();
+
+  block_map.reset();
+  used = 0;
+}
+
+
+const JIT::BLOCK *JIT::lookup(CHIP8_MEMORY& memory, const Word& pc) {
+  // Translate the block at pc on first use, addresses wrap like the CPU's
+  const Word at = pc & (MEM_SIZE - 1);
+  const BLOCK *block = blocks[at].get();
+  if(block == nullptr)
+    block = compile(memory, at);
+
+  return block;
+}
+
+
+void JIT::invalidate(const Word& addr) {
+  if(addr >= MEM_SIZE || !block_map[addr])
+    return;
+
+  block_map.reset();
+
+  // Drop the blocks covering addr and remap the remaining ones
+  for(std::unique_ptr<BLOCK>& block : blocks) {
+    if(!block)
+      continue;
+
+    const Word end = std::max<Word>(block->end, block->start + 2);
+    if(block->start <= addr && addr < end) {
+      block.reset();
+      continue;
+    }
+
+    for(Word n = block->start; n < end && n < MEM_SIZE; n++)
+      block_map[n] = true;
+  }
+}
+
+
+// ------- JIT private functions
+
+const JIT::BLOCK *JIT::compile(CHIP8_MEMORY& memory, const Word& pc) {
+  // Start over when the code buffer can not fit another block
+  if(used + 0x1000 > JIT_BUFFER)
+    reset();
+
+  std::unique_ptr<BLOCK> block = std::make_unique<BLOCK>();
+  block->func = nullptr;
+  block->start = pc;
+  block->end = pc;
+  block->count = 0;
+
+  host.fill(-1);
+  allocated = 0;
+
+  // Collect translatable instructions up to the first jump
+  std::vector<Word> ops;
+  Word target = 0;
+  bool jump = false;
+
+  while(initialized && block->end + 1 < MEM_SIZE && ops.size() < BLOCK_MAX) {
+    const Word op = (memory.read(block->end) << 8) | memory.read(block->end + 1);
+
+    std::uint32_t mask = 0;
+    if(!jit_operands(op, mask) || !allocate(mask))
+      break;
+
+    ops.push_back(op);
+    block->end += 2;
+
+    if((op & 0xF000) == 0x1000) {
+      target = op & 0x0FFF;
+      jump = true;
+      break;
+    }
+  }
+
+  if(!ops.empty()) {
+    code.clear();
+
+    // Prologue: preserve callee saved registers and load the CHIP8 state
+    for(unsigned int n = 0; n < allocated; n++) {
+      if(!jit_saved(jit_pool[n]))
+        continue;
+      if(jit_pool[n] >= 8)
+        emit(0x41);
+      emit(0x50 + (jit_pool[n] & 7));                  // push
+    }
+
+    for(unsigned int r = 0; r < 16; r++) {
+      if(host[r] >= 0)
+        emitLoad(host[r], offsetof(CONTEXT, registers) + r, false);
+    }
+    if(host[16] >= 0)
+      emitLoad(host[16], offsetof(CONTEXT, i), true);
+
+    // Body
+    for(const Word& op : ops)
+      translate(op);
+
+    // Epilogue: write back the CHIP8 state and restore the host registers
+    for(unsigned int r = 0; r < 16; r++) {
+      if(host[r] >= 0)
+        emitStore(host[r], offsetof(CONTEXT, registers) + r, false);
+    }
+    if(host[16] >= 0)
+      emitStore(host[16], offsetof(CONTEXT, i), true);
+
+    const Word next = jump ? target : block->end;
+    emit(0x66);                                        // mov word [rdi + pc], imm16
+    emit(0xC7);
+    emit(0x47);
+    emit(offsetof(CONTEXT, pc));
+    emit(next & 0xFF);
+    emit(next >> 8);
+
+    for(int n = allocated - 1; n >= 0; n--) {
+      if(!jit_saved(jit_pool[n]))
+        continue;
+      if(jit_pool[n] >= 8)
+        emit(0x41);
+      emit(0x58 + (jit_pool[n] & 7));                  // pop
+    }
+    emit(0xC3);                                        // ret
+
+    block->func = install();
+    block->count = ops.size();
+  }
+
+  // Mark the bytes the block depends on, including untranslated starts
+  const Word end = std::max<Word>(block->end, pc + 2);
+  for(Word n = pc; n < end && n < MEM_SIZE; n++)
+    block_map[n] = true;
+
+  blocks[pc] = std::move(block);
+  return blocks[pc].get();
+}
+
+
+bool JIT::allocate(const std::uint32_t& mask) {
+  // Count the registers which still need a host register
+  unsigned int needed = 0;
+  for(unsigned int r = 0; r < host.size(); r++) {
+    if((mask & (1 << r)) && host[r] < 0)
+      ++needed;
+  }
+
+  if(allocated + needed > JIT_POOL)
+    return false;
+
+  for(unsigned int r = 0; r < host.size(); r++) {
+    if((mask & (1 << r)) && host[r] < 0)
+      host[r] = jit_pool[allocated++];
+  }
+
+  return true;
+}
+
+
+void JIT::translate(const Word& op) {
+  // Emit native code matching the interpreter opcode semantics
+  const int x = host[(op & 0x0F00) >> 8];
+  const int y = host[(op & 0x00F0) >> 4];
+  const int f = host[0xF];
+  const int i = host[16];
+
+  switch(op & 0xF000) {
+    case 0x6000:
+      // 6XNN - Load NN into reg X
+      emitMov(x, op & 0x00FF);
+      break;
+    case 0x7000:
+      // 7XNN - Set reg x += NN
+      emitImm(JIT_EXT_ADD, x, op & 0x00FF);
+      emitImm(JIT_EXT_AND, x, 0xFF);
+      break;
+    case 0x8000:
+      switch(op & 0xF) {
+        case 0x0:
+          // 8XY0 - Set reg x = reg y
+          emitRR(JIT_OP_MOV, x, y);
+          break;
+        case 0x1:
+          // 8XY1 - Set reg x |= reg y
+          emitRR(JIT_OP_OR, x, y);
+          break;
+        case 0x2:
+          // 8XY2 - Set reg x &= reg y
+          emitRR(JIT_OP_AND, x, y);
+          break;
+        case 0x3:
+          // 8XY3 - Set reg x ^= reg y
+          emitRR(JIT_OP_XOR, x, y);
+          break;
+        case 0x4:
+          // 8XY4 - Set reg x += reg y [REG F]
+          emitRR(JIT_OP_ADD, x, y);
+          emitImm(JIT_EXT_AND, x, 0xFF);
+          emitMov(f, 0);
+          break;
+        case 0x5:
+          // 8XY5 - Set reg x -= reg y [REG F]
+          emitSetCarry(x, y);
+          emitRR(JIT_OP_MOV, f, JIT_RAX);
+          emitRR(JIT_OP_SUB, x, y);
+          emitImm(JIT_EXT_AND, x, 0xFF);
+          break;
+        case 0x6:
+          // 8XY6 - Set reg x >>= 1 [REG F]
+          emitRR(JIT_OP_MOV, JIT_RAX, x);
+          emitImm(JIT_EXT_AND, JIT_RAX, 0x1);
+          emitRR(JIT_OP_MOV, f, JIT_RAX);
+          emitShift(JIT_EXT_SHR, x, 1);
+          break;
+        case 0x7:
+          // 8XY7 - Set reg x = y - x [REG F]
+          emitSetCarry(y, x);
+          emitRR(JIT_OP_MOV, f, JIT_RAX);
+          emitRR(JIT_OP_MOV, JIT_RAX, y);
+          emitRR(JIT_OP_SUB, JIT_RAX, x);
+          emitImm(JIT_EXT_AND, JIT_RAX, 0xFF);
+          emitRR(JIT_OP_MOV, x, JIT_RAX);
+          break;
+        case 0xE:
+          // 8XYE - Set reg x <<= 1 [REG F]
+          emitRR(JIT_OP_MOV, JIT_RAX, x);
+          emitShift(JIT_EXT_SHR, JIT_RAX, 7);
+          emitImm(JIT_EXT_AND, JIT_RAX, 0x1);
+          emitRR(JIT_OP_MOV, f, JIT_RAX);
+          emitShift(JIT_EXT_SHL, x, 1);
+          emitImm(JIT_EXT_AND, x, 0xFF);
+          break;
+      };
+      break;
+    case 0xA000:
+      // ANNN - Set reg I = NNN
+      emitMov(i, op & 0x0FFF);
+      break;
+    case 0xF000:
+      if((op & 0xFF) == 0x1E) {
+        // FX1E - Set reg i += reg x
+        emitRR(JIT_OP_ADD, i, x);
+        emitImm(JIT_EXT_AND, i, 0xFFFF);
+      } else {
+        // FX29 - reg I = (SPRITE X), imul i, x, 5
+        emit(0x40 | ((i >> 3) << 2) | (x >> 3));
+        emit(0x6B);
+        emit(0xC0 | ((i & 7) << 3) | (x & 7));
+        emit(5);
+      }
+      break;
+    default:
+      // 1NNN is handled by the epilogue
+      break;
+  }
+}
+
+
+JIT::BLOCKFUNC JIT::install() {
+#ifdef JIT_SUPPORTED
+  // Copy the code into the buffer, only making it writable while copying
+  Byte *entry = buffer + used;
+  mprotect(buffer, JIT_BUFFER, PROT_READ | PROT_WRITE);
+  std::copy(code.begin(), code.end(), entry);
+  mprotect(buffer, JIT_BUFFER, PROT_READ | PROT_EXEC);
+
+  // Keep entry points 16 byte aligned
+  used += (code.size() + 15) & ~std::size_t(15);
+  return reinterpret_cast<BLOCKFUNC>(entry);
+#else
+  return nullptr;
+#endif
+}
+
+
+// ------- JIT x86-64 emitters
+
+void JIT::emit32(const std::uint32_t& v) {
+  for(unsigned int n = 0; n < 4; n++)
+    emit((v >> (n * 8)) & 0xFF);
+}
+
+
+void JIT::emitRR(const Byte& op, const int& dst, const int& src) {
+  // op r/m32, r32 between two host registers
+  const Byte rex = 0x40 | ((src >> 3) << 2) | (dst >> 3);
+  if(rex != 0x40)
+    emit(rex);
+  emit(op);
+  emit(0xC0 | ((src & 7) << 3) | (dst & 7));
+}
+
+
+void JIT::emitImm(const Byte& ext, const int& dst, const std::uint32_t& imm) {
+  // 81 /ext id - arithmetic with a 32 bit immediate
+  if(dst >= 8)
+    emit(0x41);
+  emit(0x81);
+  emit(0xC0 | (ext << 3) | (dst & 7));
+  emit32(imm);
+}
+
+
+void JIT::emitShift(const Byte& ext, const int& dst, const Byte& imm) {
+  // C1 /ext ib - shift by an immediate
+  if(dst >= 8)
+    emit(0x41);
+  emit(0xC1);
+  emit(0xC0 | (ext << 3) | (dst & 7));
+  emit(imm);
+}
+
+
+void JIT::emitMov(const int& dst, const std::uint32_t& imm) {
+  // B8+r id - mov r32, imm32
+  if(dst >= 8)
+    emit(0x41);
+  emit(0xB8 + (dst & 7));
+  emit32(imm);
+}
+
+
+void JIT::emitLoad(const int& dst, const Byte& offset, const bool& word) {
+  // movzx r32, byte/word [rdi + offset]
+  if(dst >= 8)
+    emit(0x44);
+  emit(0x0F);
+  emit(word ? 0xB7 : 0xB6);
+  emit(0x40 | ((dst & 7) << 3) | 7);
+  emit(offset);
+}
+
+
+void JIT::emitStore(const int& src, const Byte& offset, const bool& word) {
+  // mov byte/word [rdi + offset], r8/r16. The REX prefix is always used
+  // for byte stores so sil and bpl are addressable.
+  if(word)
+    emit(0x66);
+  if(!word || src >= 8)
+    emit(0x40 | ((src >> 3) << 2));
+  emit(word ? 0x89 : 0x88);
+  emit(0x40 | ((src & 7) << 3) | 7);
+  emit(offset);
+}
+
+
+void JIT::emitSetCarry(const int& a, const int& b) {
+  // eax = (a > b) using xor eax, eax; cmp a, b; seta al
+  emitRR(JIT_OP_XOR, JIT_RAX, JIT_RAX);
+  emitRR(JIT_OP_CMP, a, b);
+  emit(0x0F);
+  emit(0x97);
+  emit(0xC0);
+}
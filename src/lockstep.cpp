@@ -0,0 +1,569 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - lockstep.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define LOCKSTEP_AVX2
+#include <immintrin.h>
+#endif
+
+
+// ------- LOCKSTEP Class Implementation ------- //
+
+// ------- Lockstep public functions
+
+void LOCKSTEP::initialize(const unsigned int& n, const unsigned int& hz) {
+  lanes = n;
+  groups = (lanes + LOCKSTEP_GROUP - 1) / LOCKSTEP_GROUP;
+  stride = std::size_t(groups) * LOCKSTEP_GROUP;
+
+  clock = (hz > 0) ? hz : CLOCK_HZ;
+  accumulator = 0;
+  elapsed = 0;
+  vectorized = 0;
+  scalar = 0;
+
+#ifdef LOCKSTEP_AVX2
+  avx2 = __builtin_cpu_supports("avx2");
+#else
+  avx2 = false;
+#endif
+
+  // Lanes start from the CPU reset state, padding lanes never run
+  registers.assign(16 * stride, 0);
+  index.assign(stride, 0);
+  pcs.assign(stride, 0x200);
+  delay.assign(stride, 0);
+  sound.assign(stride, 0);
+  active.assign(stride, 0);
+  std::fill(active.begin(), active.begin() + lanes, 0xFF);
+  shared.assign(groups, true);
+
+  debug.setEnabled(false);
+
+  cpus.clear();
+  for(unsigned int lane = 0; lane < lanes; lane++) {
+    cpus.push_back(std::make_unique<CPU>());
+    cpus.back()->initialize(&debug);
+    cpus.back()->setClock(clock);
+  }
+}
+
+
+void LOCKSTEP::open(const std::string& path, const Word& offset) {
+  if(cpus.empty())
+    return;
+
+  // Load the ROM once and copy the memory image to the other lanes
+  cpus[0]->open(path, offset);
+
+  for(unsigned int lane = 1; lane < lanes; lane++) {
+    cpus[lane]->memory = cpus[0]->memory;
+    cpus[lane]->icache.fill(nullptr);
+    cpus[lane]->clearBlocks();
+    cpus[lane]->initialized = true;
+  }
+
+  shared.assign(groups, true);
+}
+
+
+unsigned int LOCKSTEP::run(const unsigned int& cycles) {
+  if(isStopped())
+    return 0;
+
+  // Groups never interact so each one runs the whole budget in turn
+  for(unsigned int group = 0; group < groups; group++)
+    runGroup(group, cycles);
+
+  // Advance the shared emulated time the groups ran against
+  accumulator = (accumulator + std::uint64_t(cycles) * TIMER_HZ) % clock;
+  elapsed += cycles;
+
+  return cycles;
+}
+
+
+void LOCKSTEP::finalize() {
+  for(std::unique_ptr<CPU>& cpu : cpus)
+    cpu->finalize();
+
+  cpus.clear();
+}
+
+
+CPU *LOCKSTEP::getLane(const unsigned int& lane) {
+  // Bring the lane CPU up to date with the lane arrays
+  load(lane);
+  return cpus[lane].get();
+}
+
+
+void LOCKSTEP::setKey(const unsigned int& lane, const int& n) {
+  cpus[lane]->setKey(n);
+}
+
+
+void LOCKSTEP::setSeed(const std::uint64_t& seed) {
+  // Consecutive seeds, lane 0 matches a single CPU with the same seed
+  for(unsigned int lane = 0; lane < lanes; lane++)
+    cpus[lane]->setSeed(seed + lane);
+}
+
+
+bool LOCKSTEP::isStopped() {
+  // Stopped once every lane has halted or waits for a key
+  for(unsigned int lane = 0; lane < lanes; lane++) {
+    if(active[lane] && !cpus[lane]->waiting)
+      return false;
+  }
+
+  return true;
+}
+
+
+// ------- Lockstep private functions
+
+void LOCKSTEP::runGroup(const unsigned int& group, const unsigned int& cycles) {
+  const std::size_t base = std::size_t(group) * LOCKSTEP_GROUP;
+  unsigned int timer = accumulator;
+
+  unsigned int live = 0;
+  for(std::size_t lane = base; lane < base + LOCKSTEP_GROUP; lane++)
+    live += (active[lane] != 0);
+
+  for(unsigned int n = 0; n < cycles && live > 0; n++) {
+    const CPU::INSTRUCTION *op = uniform(group);
+
+    if(op != nullptr) {
+      // Every live lane runs the same instruction
+      if(avx2)
+        executeGroupAVX2(group, op);
+      else
+        executeGroup(group, op);
+      vectorized += live;
+    } else {
+      // Diverged lanes or an instruction that touches memory or display
+      for(std::size_t lane = base; lane < base + LOCKSTEP_GROUP; lane++) {
+        if(!active[lane])
+          continue;
+
+        executeLane(lane);
+        scalar++;
+        if(!active[lane])
+          live--;
+      }
+    }
+
+    // Same arithmetic as CHIP8_TIMER::update for one instruction
+    timer += TIMER_HZ;
+    if(timer >= clock) {
+      tick(group, timer / clock);
+      timer %= clock;
+    }
+  }
+}
+
+
+const CPU::INSTRUCTION *LOCKSTEP::uniform(const unsigned int& group) {
+  const std::size_t base = std::size_t(group) * LOCKSTEP_GROUP;
+
+  // Find the first live lane
+  std::size_t first = base;
+  while(first < base + LOCKSTEP_GROUP && !active[first])
+    first++;
+
+  if(first == base + LOCKSTEP_GROUP)
+    return nullptr;
+
+  // All live lanes must sit at the same address
+  const Word pc = pcs[first] & (MEM_SIZE - 1);
+  for(std::size_t lane = first + 1; lane < base + LOCKSTEP_GROUP; lane++) {
+    if(active[lane] && (pcs[lane] & (MEM_SIZE - 1)) != pc)
+      return nullptr;
+  }
+
+  const CPU::INSTRUCTION *op = cpus[first]->decode(pc);
+  if(!vectorizable(op))
+    return nullptr;
+
+  // After a memory write the lanes may hold different code at PC
+  if(!shared[group]) {
+    for(std::size_t lane = first + 1; lane < base + LOCKSTEP_GROUP; lane++) {
+      if(active[lane] && cpus[lane]->decode(pc) != op)
+        return nullptr;
+    }
+  }
+
+  return op;
+}
+
+
+void LOCKSTEP::executeGroup(const unsigned int& group, const CPU::INSTRUCTION *op) {
+  const std::size_t base = std::size_t(group) * LOCKSTEP_GROUP;
+
+  Byte *vx = &registers[op->x * stride + base];
+  Byte *vy = &registers[op->y * stride + base];
+  Byte *vf = &registers[0xF * stride + base];
+  Word *ri = &index[base];
+  Word *pc = &pcs[base];
+  Byte *dt = &delay[base];
+  Byte *st = &sound[base];
+  const Byte *live = &active[base];
+
+  // Lane by lane in the same order as the opcode functions, VF may alias VX
+  for(unsigned int n = 0; n < LOCKSTEP_GROUP; n++) {
+    if(!live[n])
+      continue;
+
+    switch(op->id) {
+      case CPU::OP_JMP:
+        pc[n] = op->nnn;
+        continue;
+      case CPU::OP_SI:
+        pc[n] += (vx[n] == op->nn) ? 4 : 2;
+        continue;
+      case CPU::OP_SNEN:
+        pc[n] += (vx[n] != op->nn) ? 4 : 2;
+        continue;
+      case CPU::OP_SE:
+        pc[n] += (vx[n] == vy[n]) ? 4 : 2;
+        continue;
+      case CPU::OP_SNEY:
+        pc[n] += (vx[n] != vy[n]) ? 4 : 2;
+        continue;
+      case CPU::OP_LDN:
+        vx[n] = op->nn;
+        break;
+      case CPU::OP_ADN:
+        vx[n] += op->nn;
+        break;
+      case CPU::OP_LDX:
+        vx[n] = vy[n];
+        break;
+      case CPU::OP_ORX:
+        vx[n] |= vy[n];
+        break;
+      case CPU::OP_ANX:
+        vx[n] &= vy[n];
+        break;
+      case CPU::OP_XOR:
+        vx[n] ^= vy[n];
+        break;
+      case CPU::OP_ADC:
+        vx[n] += vy[n];
+        vf[n] = 0;
+        break;
+      case CPU::OP_SUB:
+        vf[n] = (vx[n] > vy[n]) ? 1 : 0;
+        vx[n] -= vy[n];
+        break;
+      case CPU::OP_SRH:
+        vf[n] = vx[n] & 0x1;
+        vx[n] >>= 1;
+        break;
+      case CPU::OP_SUBN:
+        vf[n] = (vy[n] > vx[n]) ? 1 : 0;
+        vx[n] = vy[n] - vx[n];
+        break;
+      case CPU::OP_SHL:
+        vf[n] = (vx[n] & 0x80) >> 7;
+        vx[n] <<= 1;
+        break;
+      case CPU::OP_LDI:
+        ri[n] = op->nnn;
+        break;
+      case CPU::OP_LXD:
+        vx[n] = dt[n];
+        break;
+      case CPU::OP_LDT:
+        dt[n] = vx[n];
+        break;
+      case CPU::OP_LSX:
+        st[n] = vx[n];
+        break;
+      case CPU::OP_ADI:
+        ri[n] += vx[n];
+        break;
+      case CPU::OP_LDS:
+        ri[n] = vx[n] * 5;
+        break;
+    }
+
+    pc[n] += 2;
+  }
+}
+
+
+void LOCKSTEP::executeLane(const unsigned int& lane) {
+  CPU& cpu = *cpus[lane];
+
+  // Interpret one instruction on the lane CPU
+  load(lane);
+  cpu.instr = cpu.decode(cpu.pc);
+  cpu.opcode = cpu.instr->opcode;
+  cpu.execute();
+  store(lane);
+
+  // Lanes of the group may no longer share their code
+  if(cpu.instr->id == CPU::OP_LDB || cpu.instr->id == CPU::OP_LDM)
+    shared[lane / LOCKSTEP_GROUP] = false;
+
+  if(cpu.halt)
+    active[lane] = 0;
+}
+
+
+void LOCKSTEP::tick(const unsigned int& group, const unsigned int& ticks) {
+  const std::size_t base = std::size_t(group) * LOCKSTEP_GROUP;
+
+  for(std::size_t lane = base; lane < base + LOCKSTEP_GROUP; lane++) {
+    delay[lane] = (delay[lane] > ticks) ? delay[lane] - ticks : 0;
+    sound[lane] = (sound[lane] > ticks) ? sound[lane] - ticks : 0;
+  }
+}
+
+
+void LOCKSTEP::load(const unsigned int& lane) {
+  // Copy the lane arrays into the lane CPU
+  CPU& cpu = *cpus[lane];
+  for(unsigned int r = 0; r < 16; r++)
+    cpu.registers[r] = registers[r * stride + lane];
+
+  cpu.i = index[lane];
+  cpu.pc = pcs[lane] & (MEM_SIZE - 1);
+  cpu.timer.setDelay(delay[lane]);
+  cpu.timer.setSound(sound[lane]);
+}
+
+
+void LOCKSTEP::store(const unsigned int& lane) {
+  // Copy the lane CPU back into the lane arrays
+  CPU& cpu = *cpus[lane];
+  for(unsigned int r = 0; r < 16; r++)
+    registers[r * stride + lane] = cpu.registers[r];
+
+  index[lane] = cpu.i;
+  pcs[lane] = cpu.pc;
+  delay[lane] = cpu.timer.getDelay();
+  sound[lane] = cpu.timer.getSound();
+}
+
+
+bool LOCKSTEP::vectorizable(const CPU::INSTRUCTION *op) {
+  // Instructions that only touch V0-VF, I, PC and the timers
+  switch(op->id) {
+    case CPU::OP_JMP:
+    case CPU::OP_SI:
+    case CPU::OP_SNEN:
+    case CPU::OP_SE:
+    case CPU::OP_LDN:
+    case CPU::OP_ADN:
+    case CPU::OP_LDX:
+    case CPU::OP_ORX:
+    case CPU::OP_ANX:
+    case CPU::OP_XOR:
+    case CPU::OP_ADC:
+    case CPU::OP_SUB:
+    case CPU::OP_SRH:
+    case CPU::OP_SUBN:
+    case CPU::OP_SHL:
+    case CPU::OP_SNEY:
+    case CPU::OP_LDI:
+    case CPU::OP_LXD:
+    case CPU::OP_LDT:
+    case CPU::OP_LSX:
+    case CPU::OP_ADI:
+    case CPU::OP_LDS:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+// ------- Lockstep AVX2 group execution
+
+#ifdef LOCKSTEP_AVX2
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+static inline __m256i lockstep_load(const void *src) {
+  return _mm256_loadu_si256(static_cast<const __m256i*>(src));
+}
+
+
+static inline void lockstep_store(void *dst, const __m256i& value, const __m256i& mask) {
+  // Only lanes set in mask are written
+  __m256i *out = static_cast<__m256i*>(dst);
+  _mm256_storeu_si256(out, _mm256_blendv_epi8(_mm256_loadu_si256(out), value, mask));
+}
+
+
+static inline __m256i lockstep_greater(const __m256i& a, const __m256i& b) {
+  // Unsigned a > b, there is no unsigned byte compare
+  const __m256i equal = _mm256_cmpeq_epi8(a, b);
+  return _mm256_andnot_si256(equal, _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a));
+}
+
+
+static inline __m256i lockstep_mask(const __m256i& bytes, const int& half) {
+  // Sign extend 16 byte lanes to word lanes
+  if(half == 0)
+    return _mm256_cvtepi8_epi16(_mm256_castsi256_si128(bytes));
+  return _mm256_cvtepi8_epi16(_mm256_extracti128_si256(bytes, 1));
+}
+
+
+static inline __m256i lockstep_widen(const __m256i& bytes, const int& half) {
+  // Zero extend 16 byte lanes to word lanes
+  if(half == 0)
+    return _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+  return _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+}
+
+
+void LOCKSTEP::executeGroupAVX2(const unsigned int& group, const CPU::INSTRUCTION *op) {
+  const std::size_t base = std::size_t(group) * LOCKSTEP_GROUP;
+
+  Byte *vx = &registers[op->x * stride + base];
+  Byte *vy = &registers[op->y * stride + base];
+  Byte *vf = &registers[0xF * stride + base];
+  Word *ri = &index[base];
+  Word *pc = &pcs[base];
+
+  const __m256i live = lockstep_load(&active[base]);
+  const __m256i ones = _mm256_cmpeq_epi8(live, live);
+  const __m256i bit = _mm256_set1_epi8(1);
+  const __m256i nn = _mm256_set1_epi8(static_cast<char>(op->nn));
+
+  // VF is stored before VX is reloaded so VF aliasing VX matches the opcodes
+  __m256i skip = _mm256_setzero_si256();
+  bool jump = false;
+
+  switch(op->id) {
+    case CPU::OP_JMP:
+      jump = true;
+      break;
+    case CPU::OP_SI:
+      skip = _mm256_cmpeq_epi8(lockstep_load(vx), nn);
+      break;
+    case CPU::OP_SNEN:
+      skip = _mm256_xor_si256(_mm256_cmpeq_epi8(lockstep_load(vx), nn), ones);
+      break;
+    case CPU::OP_SE:
+      skip = _mm256_cmpeq_epi8(lockstep_load(vx), lockstep_load(vy));
+      break;
+    case CPU::OP_SNEY:
+      skip = _mm256_xor_si256(_mm256_cmpeq_epi8(lockstep_load(vx), lockstep_load(vy)), ones);
+      break;
+    case CPU::OP_LDN:
+      lockstep_store(vx, nn, live);
+      break;
+    case CPU::OP_ADN:
+      lockstep_store(vx, _mm256_add_epi8(lockstep_load(vx), nn), live);
+      break;
+    case CPU::OP_LDX:
+      lockstep_store(vx, lockstep_load(vy), live);
+      break;
+    case CPU::OP_ORX:
+      lockstep_store(vx, _mm256_or_si256(lockstep_load(vx), lockstep_load(vy)), live);
+      break;
+    case CPU::OP_ANX:
+      lockstep_store(vx, _mm256_and_si256(lockstep_load(vx), lockstep_load(vy)), live);
+      break;
+    case CPU::OP_XOR:
+      lockstep_store(vx, _mm256_xor_si256(lockstep_load(vx), lockstep_load(vy)), live);
+      break;
+    case CPU::OP_ADC:
+      lockstep_store(vx, _mm256_add_epi8(lockstep_load(vx), lockstep_load(vy)), live);
+      lockstep_store(vf, _mm256_setzero_si256(), live);
+      break;
+    case CPU::OP_SUB:
+      lockstep_store(vf, _mm256_and_si256(lockstep_greater(lockstep_load(vx), lockstep_load(vy)), bit), live);
+      lockstep_store(vx, _mm256_sub_epi8(lockstep_load(vx), lockstep_load(vy)), live);
+      break;
+    case CPU::OP_SRH:
+      lockstep_store(vf, _mm256_and_si256(lockstep_load(vx), bit), live);
+      lockstep_store(vx, _mm256_and_si256(_mm256_srli_epi16(lockstep_load(vx), 1), _mm256_set1_epi8(0x7F)), live);
+      break;
+    case CPU::OP_SUBN:
+      lockstep_store(vf, _mm256_and_si256(lockstep_greater(lockstep_load(vy), lockstep_load(vx)), bit), live);
+      lockstep_store(vx, _mm256_sub_epi8(lockstep_load(vy), lockstep_load(vx)), live);
+      break;
+    case CPU::OP_SHL:
+      lockstep_store(vf, _mm256_and_si256(_mm256_srli_epi16(lockstep_load(vx), 7), bit), live);
+      lockstep_store(vx, _mm256_add_epi8(lockstep_load(vx), lockstep_load(vx)), live);
+      break;
+    case CPU::OP_LXD:
+      lockstep_store(vx, lockstep_load(&delay[base]), live);
+      break;
+    case CPU::OP_LDT:
+      lockstep_store(&delay[base], lockstep_load(vx), live);
+      break;
+    case CPU::OP_LSX:
+      lockstep_store(&sound[base], lockstep_load(vx), live);
+      break;
+    case CPU::OP_LDI:
+    case CPU::OP_ADI:
+    case CPU::OP_LDS:
+      // I is 16 bits wide so it takes two vectors per group
+      for(int half = 0; half < 2; half++) {
+        Word *dst = ri + half * 16;
+        const __m256i x = lockstep_widen(lockstep_load(vx), half);
+        __m256i value = _mm256_set1_epi16(static_cast<short>(op->nnn));
+
+        if(op->id == CPU::OP_ADI)
+          value = _mm256_add_epi16(lockstep_load(dst), x);
+        else if(op->id == CPU::OP_LDS)
+          value = _mm256_mullo_epi16(x, _mm256_set1_epi16(5));
+
+        lockstep_store(dst, value, lockstep_mask(live, half));
+      }
+      break;
+  }
+
+  // Advance PC by 2, or 4 where the skip was taken, or jump
+  for(int half = 0; half < 2; half++) {
+    Word *dst = pc + half * 16;
+    __m256i value = _mm256_set1_epi16(static_cast<short>(op->nnn));
+
+    if(!jump) {
+      const __m256i step = _mm256_add_epi16(_mm256_set1_epi16(2), _mm256_and_si256(lockstep_mask(skip, half), _mm256_set1_epi16(2)));
+      value = _mm256_add_epi16(lockstep_load(dst), step);
+    }
+
+    lockstep_store(dst, value, lockstep_mask(live, half));
+  }
+}
+
+#pragma GCC pop_options
+#else
+
+void LOCKSTEP::executeGroupAVX2(const unsigned int& group, const CPU::INSTRUCTION *op) {
+  // Never selected without AVX2 support
+  executeGroup(group, op);
+}
+
+#endif
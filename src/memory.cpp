@@ -60,15 +60,3 @@ void CHIP8_MEMORY::reset() {
   for(unsigned int i = 0; i < 80; i++)
     MEMORY[i] = c8_fontset[i];
 }
-
-
-void CHIP8_MEMORY::write(const Word& addr, const Byte& value) {
-  // Write the value to addr in memory
-  MEMORY[addr] = value;
-}
-
-
-const Byte& CHIP8_MEMORY::read(const Word& addr) {
-  // Return the addr value in memory
-  return MEMORY[addr];
-}
@@ -0,0 +1,109 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - movie.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- MOVIE Class Implementation ------- //
+
+// ------- Movie recording functions
+
+void MOVIE::initialize(const std::uint64_t& seed, const unsigned int& clock) {
+  std::copy(MOVIE_MAGIC, MOVIE_MAGIC + 4, header.magic);
+  header.version = MOVIE_VERSION;
+  header.clock = clock;
+  header.count = 0;
+  header.seed = seed;
+  header.end = 0;
+  header.digest = 0;
+
+  events.clear();
+  cursor = 0;
+}
+
+
+void MOVIE::truncate(const std::size_t& count) {
+  // After a rewind only the presses the restored state had seen remain,
+  // counted rather than compared by cycle as presses can share a cycle
+  if(count < events.size())
+    events.resize(count);
+}
+
+
+bool MOVIE::write(const std::string& path, const std::uint64_t& end, const std::uint64_t& digest) {
+  header.count = std::uint32_t(events.size());
+  header.end = end;
+  header.digest = digest;
+
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  output.write(reinterpret_cast<const char*>(&header), sizeof(HEADER));
+  output.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(std::uint64_t));
+
+  if(!output.good()) {
+    std::cerr << "[CHIP8] Unable to write movie: " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+
+// ------- Movie replay functions
+
+bool MOVIE::read(const std::string& path) {
+  std::ifstream input(path, std::ios::binary);
+  if(!input.is_open()) {
+    std::cerr << "[CHIP8] Unable to open movie: " << path << std::endl;
+    return false;
+  }
+
+  input.read(reinterpret_cast<char*>(&header), sizeof(HEADER));
+  if(!input || !std::equal(MOVIE_MAGIC, MOVIE_MAGIC + 4, header.magic) || header.version != MOVIE_VERSION) {
+    std::cerr << "[CHIP8] Not a version " << MOVIE_VERSION << " movie: " << path << std::endl;
+    return false;
+  }
+
+  // Read event by event so a damaged count cannot run away
+  std::uint64_t event;
+  events.clear();
+  while(events.size() < header.count && input.read(reinterpret_cast<char*>(&event), sizeof(event)))
+    events.push_back(event);
+
+  if(events.size() != header.count) {
+    std::cerr << "[CHIP8] Movie is truncated: " << path << std::endl;
+    return false;
+  }
+
+  cursor = 0;
+  return true;
+}
+
+
+bool MOVIE::due(const std::uint64_t& cycle, int& key) {
+  // Hand out the next press once emulated time has reached it
+  if(finished() || next() > cycle)
+    return false;
+
+  key = events[cursor++] & 0xF;
+  return true;
+}
@@ -23,6 +23,11 @@ along with chip8. If not, see <https://www.gnu.org/licenses/>.
 
 #include "chip8.hpp"
 
+#if defined(__SSE2__) && defined(__x86_64__)
+#define DRAW_SSE2
+#include <emmintrin.h>
+#endif
+
 
 //------- Opcode Function Implementation ------- //
 
@@ -48,7 +53,7 @@ void CPU::opcode_sys() {
 void CPU::opcode_cls() {
   // 00E0 - Clear display
   display.fill(0);
-  window->draw(display);
+  dirty = RECT{0, 0, SCREEN_W, SCREEN_H};
   pc += 2;
 }
 
@@ -62,21 +67,21 @@ void CPU::opcode_ret() {
 
 void CPU::opcode_jmp() {
   // 1NNN - Jump to NNN
-  pc = opcode & 0x0FFF;
+  pc = instr->nnn;
 }
 
 
 void CPU::opcode_cal() {
   // 2NNN - Call subroutine at NNN
   stack[sp++] = pc;
-  pc = opcode & 0x0FFF;
+  pc = instr->nnn;
 }
 
 
 void CPU::opcode_si() {
   // 3XNN - Skip next instr if X == NN
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte nn = opcode & 0x00FF;
+  Byte x = instr->x;
+  Byte nn = instr->nn;
 
   if(registers[x] == nn)
     pc += 4;
@@ -87,8 +92,8 @@ void CPU::opcode_si() {
 
 void CPU::opcode_snen() {
   // 4XNN - Skip next instr if reg X != NN
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte nn = opcode & 0x00FF;
+  Byte x = instr->x;
+  Byte nn = instr->nn;
 
   if(registers[x] != nn)
     pc += 4;
@@ -99,8 +104,8 @@ void CPU::opcode_snen() {
 
 void CPU::opcode_se() {
   // 5XY0 - Skip next instr if reg X = reg Y
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   if(registers[x] == registers[y])
     pc += 4;
@@ -111,24 +116,24 @@ void CPU::opcode_se() {
 
 void CPU::opcode_ldn() {
   // 6XNN - Load NN into reg X
-  Byte x = (opcode & 0x0F00) >> 8;
-  registers[x] = opcode & 0x00FF;
+  Byte x = instr->x;
+  registers[x] = instr->nn;
   pc += 2;
 }
 
 
 void CPU::opcode_adn() {
   // 7XNN - Set reg x += NN
-  Byte x = (opcode & 0x0F00) >> 8;
-  registers[x] += (opcode & 0x00FF);
+  Byte x = instr->x;
+  registers[x] += instr->nn;
   pc += 2;
 }
 
 
 void CPU::opcode_ldx() {
   // 8XY0 - Set reg x = reg y
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   registers[x] = registers[y];
   pc += 2;
@@ -137,8 +142,8 @@ void CPU::opcode_ldx() {
 
 void CPU::opcode_orx() {
   // 8XY1 - Set reg x |= reg y
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   registers[x] |= registers[y];
   pc += 2;
@@ -147,8 +152,8 @@ void CPU::opcode_orx() {
 
 void CPU::opcode_anx() {
   // 8XY2 - Set reg x &= reg y
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   registers[x] &= registers[y];
   pc += 2;
@@ -157,8 +162,8 @@ void CPU::opcode_anx() {
 
 void CPU::opcode_xor() {
   // 8XY3 - Set reg x ^= reg y
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   registers[x] ^= registers[y];
   pc += 2;
@@ -167,8 +172,8 @@ void CPU::opcode_xor() {
 
 void CPU::opcode_adc() {
   // 8XY4 - Set reg x += reg y [REG F]
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   // Add the registers
   Word value = registers[x] + registers[y];
@@ -182,8 +187,8 @@ void CPU::opcode_adc() {
 
 void CPU::opcode_sub() {
   // 8XY5 - Set reg x -= reg y [REG F]
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   // Set the carry flag
   if(registers[x] > registers[y])
@@ -200,7 +205,7 @@ void CPU::opcode_sub() {
 
 void CPU::opcode_srh() {
   // 8XY6 - Set reg x >>= 1 [REG F]
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
   // Set the carry flag
   registers[0xF] = registers[x] & 0x1;
@@ -212,8 +217,8 @@ void CPU::opcode_srh() {
 
 void CPU::opcode_subn() {
   // 8XY7 - Set reg x = x - y [REG F]
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   // Set the carry flag
   if(registers[y] > registers[x])
@@ -230,7 +235,7 @@ void CPU::opcode_subn() {
 
 void CPU::opcode_shl() {
   // 8XYE - Set reg x <<= 1 [REG F]
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
   // Set the MSB flag
   registers[0xF] = (registers[x] & 0x80) >> 7;
@@ -242,8 +247,8 @@ void CPU::opcode_shl() {
 
 void CPU::opcode_sney() {
   // 9XY0 - Skip next instr if reg x != reg Y
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
+  Byte x = instr->x;
+  Byte y = instr->y;
 
   if(registers[x] != registers[y])
     pc += 4;
@@ -254,23 +259,23 @@ void CPU::opcode_sney() {
 
 void CPU::opcode_ldi() {
   // ANNN - Set reg I = NNN
-  i = opcode & 0xFFF;
+  i = instr->nnn;
   pc += 2;
 }
 
 
 void CPU::opcode_jpa() {
   // BNNN - Set PC = NNN + reg 0
-  pc = (opcode & 0xFFF) + registers[0];
+  pc = instr->nnn + registers[0];
 }
 
 
 void CPU::opcode_rnd() {
   // CXNN - Set reg x = (RANDOM) & NN
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte nn = (opcode & 0x00FF);
+  Byte x = instr->x;
+  Byte nn = instr->nn;
 
-  registers[x] = randomNumber(0, 0xFF) & nn;
+  registers[x] = rng.byte() & nn;
 
   pc += 2;
 }
@@ -278,36 +283,68 @@ void CPU::opcode_rnd() {
 
 void CPU::opcode_drw() {
   // DXYN - Draw function
-  Byte x = registers[(opcode & 0x0F00) >> 8];
-  Byte y = registers[(opcode & 0x00F0) >> 4];
-  Byte h = opcode & 0x000F;
-  Byte pixel = 0;
-
-  // Set the VF register to 0
-  registers[0xF] = 0;
-
-  for(int ypos = 0; ypos < h; ypos++) {
-    // Read the pixel to memory
-    pixel = memory_read(ypos + i);
-    for(int xpos = 0; xpos < 8; xpos++) {
-      if((pixel & (0x80 >> xpos)) != 0) {
-        // Check for collision
-        if(display[(x + xpos + ((y + ypos) * 64))] == 1)
-          registers[0xF] = 1;
-        // Set the pixel
-        display[(x + xpos + ((y + ypos) * 64))] ^= 1;
-      }
-    }
+  const unsigned int x = registers[instr->x] & 63;
+  const unsigned int y = registers[instr->y] & 31;
+  const unsigned int h = instr->n;
+  std::uint64_t hit = 0;
+  unsigned int row = 0;
+
+#ifdef DRAW_SSE2
+  // Two rows at a time while the sprite does not wrap to the top
+  const __m128i right = _mm_cvtsi32_si128(x);
+  const __m128i left = _mm_cvtsi32_si128(64 - x);
+  __m128i hits = _mm_setzero_si128();
+
+  for(; row + 2 <= h && y + row + 2 <= 32; row += 2) {
+    const std::uint64_t top = std::uint64_t(memory_read(row + i)) << 56;
+    const std::uint64_t bottom = std::uint64_t(memory_read(row + 1 + i)) << 56;
+
+    // Rotate both sprite rows into place, pixels wrap around the edge
+    const __m128i sprite = _mm_set_epi64x(bottom, top);
+    const __m128i bits = _mm_or_si128(_mm_srl_epi64(sprite, right), _mm_sll_epi64(sprite, left));
+
+    __m128i *line = reinterpret_cast<__m128i*>(&display[y + row]);
+    const __m128i pixels = _mm_loadu_si128(line);
+    hits = _mm_or_si128(hits, _mm_and_si128(pixels, bits));
+    _mm_storeu_si128(line, _mm_xor_si128(pixels, bits));
+  }
+
+  hit = _mm_cvtsi128_si64(_mm_or_si128(hits, _mm_unpackhi_epi64(hits, hits)));
+#endif
+
+  for(; row < h; row++) {
+    // Rotate the sprite row into place, pixels wrap around the edge
+    const std::uint64_t sprite = std::uint64_t(memory_read(row + i)) << 56;
+    const std::uint64_t bits = (sprite >> x) | (sprite << ((64 - x) & 63));
+
+    std::uint64_t& line = display[(y + row) & 31];
+    hit |= line & bits;
+    line ^= bits;
   }
 
-  window->draw(display);
+  // Any pixel turned off is a collision
+  registers[0xF] = (hit != 0) ? 1 : 0;
+
+  // Sprites wrapping past an edge mark the full width or height
+  const bool wide = int(x) + 8 > SCREEN_W;
+  const bool tall = int(y + h) > SCREEN_H;
+
+  RECT area;
+  area.x = wide ? 0 : x;
+  area.w = wide ? SCREEN_W : 8;
+  area.y = tall ? 0 : y;
+  area.h = tall ? SCREEN_H : h;
+  dirty.merge(area);
+
+  if(profiler != nullptr)
+    profiler->draw();
   pc += 2;
 }
 
 
 void CPU::opcode_skp() {
   // EX9E - Skip instr if key X == pressed
-  Byte x = registers[(opcode & 0x0F00) >> 8];
+  Byte x = registers[instr->x];
 
   if(key[x] != 0) {
     key[x] = 0;
@@ -320,7 +357,7 @@ void CPU::opcode_skp() {
 
 void CPU::opcode_sknp() {
   // EXA1 - Skip instr if key x != pressed
-  Byte x = registers[(opcode & 0x0F00) >> 8];
+  Byte x = registers[instr->x];
 
   if(key[x] == 0)
     pc += 2;
@@ -331,61 +368,54 @@ void CPU::opcode_sknp() {
 
 void CPU::opcode_lxd(){
   // FX07 - reg x = delay timer
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
-  registers[x] = delay_timer;
+  registers[x] = timer.getDelay();
   pc += 2;
 }
 
 
 void CPU::opcode_ldk() {
   // FX0A - Wait for key and store in reg x
-  SDL_Event event;
-  SDL_WaitEvent(&event);
-  
-  switch(event.type) {
-    case SDL_QUIT:
-      halt = true;
-      return;
-    case SDL_KEYDOWN:
-      for(unsigned int n = 0; n < 16; n++) {
-        if(event.key.keysym.sym == chip8_key[n]) {
-          registers[(opcode & 0x0F00) >> 8] = n;
-          key[n] = 1;
-          pc += 2;
-          return;
-        }
-      }
-      break;
-    default:
-      break;
+  if(!waiting) {
+    // Start waiting for a fresh key press
+    key.fill(0);
+    waiting = true;
+    return;
   }
 
-  pc += 2;
+  for(unsigned int n = 0; n < 16; n++) {
+    if(key[n] != 0) {
+      registers[instr->x] = n;
+      waiting = false;
+      pc += 2;
+      return;
+    }
+  }
 }
 
 
 void CPU::opcode_ldt() {
   // FX15 - delay timer = reg x
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
-  delay_timer = registers[x];
+  timer.setDelay(registers[x]);
   pc += 2;
 }
 
 
 void CPU::opcode_lsx() {
   // FX18 - sound timer = reg x
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
-  sound_timer = registers[x];
+  timer.setSound(registers[x]);
   pc += 2;
 }
 
 
 void CPU::opcode_adi() {
   // FX1E - Set reg i += reg x
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
   i += registers[x];
   pc += 2;
@@ -394,7 +424,7 @@ void CPU::opcode_adi() {
 
 void CPU::opcode_lds() {
   // FX29 - reg I = (SPRITE X)
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
   i = registers[x] * 5;
   pc += 2;
@@ -403,7 +433,7 @@ void CPU::opcode_lds() {
 
 void CPU::opcode_ldb() {
   // FX33 - Store reg x in mem[reg i++]
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
 
   Byte value = registers[x];
   memory_write(i, value / 100);
@@ -415,7 +445,7 @@ void CPU::opcode_ldb() {
 
 void CPU::opcode_ldm() {
   // FX55 - Store reg 0 -> reg x in mem[reg I]
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
   ++x;  // Increment to include x in the reg dump
 
   for(Byte n = 0; n < x; n++)
@@ -426,10 +456,107 @@ void CPU::opcode_ldm() {
 
 void CPU::opcode_rdx() {
   // FX65 - Read reg 0 -> reg x from mem[reg I]
-  Byte x = (opcode & 0x0F00) >> 8;
+  Byte x = instr->x;
   ++x;  // Increment to include x in the reg pull
 
   for(Byte n = 0; n < x; n++)
     registers[n] = memory_read(i + n);
   pc += 2;
 }
+
+
+//------- Threaded Interpreter Implementation ------- //
+
+unsigned int CPU::runThreaded(const unsigned int& count) {
+  // Run up to count instructions jumping straight from one handler to
+  // the next. The handlers are defined above so they are inlined here.
+  unsigned int executed = 0;
+  if(count == 0 || halt)
+    return executed;
+
+#if defined(__GNUC__)
+  static const void *labels[OP_COUNT] = {
+    &&op_none, &&op_nop, &&op_sys, &&op_cls, &&op_ret, &&op_jmp, &&op_cal,
+    &&op_si, &&op_snen, &&op_se, &&op_ldn, &&op_adn, &&op_ldx, &&op_orx,
+    &&op_anx, &&op_xor, &&op_adc, &&op_sub, &&op_srh, &&op_subn, &&op_shl,
+    &&op_sney, &&op_ldi, &&op_jpa, &&op_rnd, &&op_drw, &&op_skp, &&op_sknp,
+    &&op_lxd, &&op_ldk, &&op_ldt, &&op_lsx, &&op_adi, &&op_lds, &&op_ldb,
+    &&op_ldm, &&op_rdx
+  };
+
+// Decode the instruction at PC and jump to its handler
+#define THREADED_DISPATCH()                                 \
+  pc &= MEM_SIZE - 1;                                       \
+  instr = icache[pc];                                       \
+  if(instr == nullptr)                                      \
+    instr = decode(pc);                                     \
+  opcode = instr->opcode;                                   \
+  trace();                                                  \
+  profile();                                                \
+  goto *labels[instr->id]
+
+// Finish the instruction and continue with the next one
+#define THREADED_NEXT()                                     \
+  timer.update(1);                                          \
+  if(++executed == count || halt || waiting)                \
+    return executed;                                        \
+  THREADED_DISPATCH()
+
+#define THREADED_OPCODE(name)                               \
+  op_##name:                                                \
+    opcode_##name();                                        \
+    THREADED_NEXT();
+
+  THREADED_DISPATCH();
+
+  THREADED_OPCODE(none)
+  THREADED_OPCODE(nop)
+  THREADED_OPCODE(sys)
+  THREADED_OPCODE(cls)
+  THREADED_OPCODE(ret)
+  THREADED_OPCODE(jmp)
+  THREADED_OPCODE(cal)
+  THREADED_OPCODE(si)
+  THREADED_OPCODE(snen)
+  THREADED_OPCODE(se)
+  THREADED_OPCODE(ldn)
+  THREADED_OPCODE(adn)
+  THREADED_OPCODE(ldx)
+  THREADED_OPCODE(orx)
+  THREADED_OPCODE(anx)
+  THREADED_OPCODE(xor)
+  THREADED_OPCODE(adc)
+  THREADED_OPCODE(sub)
+  THREADED_OPCODE(srh)
+  THREADED_OPCODE(subn)
+  THREADED_OPCODE(shl)
+  THREADED_OPCODE(sney)
+  THREADED_OPCODE(ldi)
+  THREADED_OPCODE(jpa)
+  THREADED_OPCODE(rnd)
+  THREADED_OPCODE(drw)
+  THREADED_OPCODE(skp)
+  THREADED_OPCODE(sknp)
+  THREADED_OPCODE(lxd)
+  THREADED_OPCODE(ldk)
+  THREADED_OPCODE(ldt)
+  THREADED_OPCODE(lsx)
+  THREADED_OPCODE(adi)
+  THREADED_OPCODE(lds)
+  THREADED_OPCODE(ldb)
+  THREADED_OPCODE(ldm)
+  THREADED_OPCODE(rdx)
+
+#undef THREADED_OPCODE
+#undef THREADED_NEXT
+#undef THREADED_DISPATCH
+#else
+  // Without labels as values fall back to single stepping
+  while(executed < count && !halt && !waiting) {
+    step();
+    ++executed;
+  }
+
+  return executed;
+#endif
+}
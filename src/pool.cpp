@@ -0,0 +1,138 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - pool.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- POOL Class Implementation ------- //
+
+// ------- Pool public functions
+
+void POOL::initialize(const unsigned int& threads) {
+  running = true;
+  pending = 0;
+  queued = 0;
+  next = 0;
+
+  // Create one queue per worker before any worker can steal from it
+  const unsigned int count = (threads > 0) ? threads : 1;
+  for(unsigned int n = 0; n < count; n++)
+    queues.push_back(std::make_unique<QUEUE>());
+
+  for(unsigned int n = 0; n < count; n++)
+    workers.emplace_back(&POOL::work, this, n);
+}
+
+
+void POOL::submit(JOB job) {
+  // Count the job first so a worker finishing it never takes the counters below zero
+  {
+    std::lock_guard<std::mutex> guard(signal_lock);
+    ++pending;
+    ++queued;
+  }
+
+  // Spread new jobs over the workers
+  QUEUE& queue = *queues[next++ % queues.size()];
+  {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.jobs.push_back(std::move(job));
+  }
+  work_ready.notify_one();
+}
+
+
+void POOL::wait() {
+  // Block until every submitted job has finished
+  std::unique_lock<std::mutex> guard(signal_lock);
+  work_done.wait(guard, [this] { return pending == 0; });
+}
+
+
+void POOL::finalize() {
+  {
+    std::lock_guard<std::mutex> guard(signal_lock);
+    running = false;
+  }
+  work_ready.notify_all();
+
+  for(std::thread& worker : workers)
+    worker.join();
+
+  workers.clear();
+  queues.clear();
+}
+
+
+// ------- Pool private functions
+
+void POOL::work(const std::size_t& id) {
+  JOB job;
+
+  while(running) {
+    if(pop(id, job) || steal(id, job)) {
+      --queued;
+      job();
+      job = nullptr;
+
+      std::lock_guard<std::mutex> guard(signal_lock);
+      if(--pending == 0)
+        work_done.notify_all();
+      continue;
+    }
+
+    // Sleep until new work arrives, queued only grows under signal_lock so no wake up is missed
+    std::unique_lock<std::mutex> guard(signal_lock);
+    work_ready.wait(guard, [this] { return !running || queued > 0; });
+  }
+}
+
+
+bool POOL::pop(const std::size_t& id, JOB& job) {
+  // Take the newest job from our own queue
+  QUEUE& queue = *queues[id];
+  std::lock_guard<std::mutex> guard(queue.lock);
+  if(queue.jobs.empty())
+    return false;
+
+  job = std::move(queue.jobs.back());
+  queue.jobs.pop_back();
+  return true;
+}
+
+
+bool POOL::steal(const std::size_t& id, JOB& job) {
+  // Take the oldest job from the next worker that has one
+  for(std::size_t n = 1; n < queues.size(); n++) {
+    QUEUE& queue = *queues[(id + n) % queues.size()];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if(queue.jobs.empty())
+      continue;
+
+    job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,153 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - profiler.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- PROFILER Class Implementation ------- //
+
+// ------- Profiler public functions
+
+void PROFILER::initialize(const unsigned int& p) {
+  // A period of 1 records every instruction
+  period = (p > 0) ? p : 1;
+  reset();
+}
+
+
+void PROFILER::reset() {
+  countdown = period;
+  instructions = 0;
+  ops.fill(0);
+  hits.fill(0);
+
+  draws = 0;
+  last_draw = 0;
+  shortest = ~std::uint64_t(0);
+  longest = 0;
+  total_interval = 0;
+  intervals.fill(0);
+}
+
+
+void PROFILER::report(std::ostream& out) {
+  const std::uint64_t sampled = std::max<std::uint64_t>(1, instructions);
+
+  out << "[CHIP8] Profile of " << instructions << " instructions";
+  if(period > 1)
+    out << ", sampled every " << period;
+  out << std::endl;
+
+  // Opcode classes by executions
+  out << "[CHIP8] Opcodes:" << std::endl;
+  for(const auto& entry : sorted(ops.data(), ops.size())) {
+    out << "\t" << std::left << std::setw(12) << CPU::describe(entry.second) << std::right
+    << std::setw(12) << entry.first << std::fixed << std::setprecision(2)
+    << std::setw(8) << 100.0 * entry.first / sampled << "%" << std::endl;
+  }
+
+  // The hottest addresses
+  out << "[CHIP8] Hot spots:" << std::endl;
+  std::size_t shown = 0;
+  for(const auto& entry : sorted(hits.data(), hits.size())) {
+    if(shown++ == PROFILE_TOP)
+      break;
+
+    out << "\t0x" << std::hex << std::setfill('0') << std::setw(4) << entry.second
+    << std::dec << std::setfill(' ') << std::setw(12) << entry.first << std::fixed
+    << std::setprecision(2) << std::setw(8) << 100.0 * entry.first / sampled << "%" << std::endl;
+  }
+
+  // Instructions between sprite draws
+  out << "[CHIP8] DXYN: " << draws << " draws";
+  if(draws > 1) {
+    out << ", " << shortest << " to " << longest << " instructions apart, "
+    << std::fixed << std::setprecision(1) << double(total_interval) / (draws - 1) << " on average";
+  }
+  out << std::endl;
+}
+
+
+void PROFILER::write(const std::string& path) {
+  Json::Value root;
+  root["instructions"] = Json::UInt64(instructions);
+  root["sample_period"] = period;
+
+  root["opcodes"] = Json::Value(Json::arrayValue);
+  for(const auto& entry : sorted(ops.data(), ops.size())) {
+    Json::Value op;
+    op["opcode"] = CPU::describe(entry.second);
+    op["count"] = Json::UInt64(entry.first);
+    root["opcodes"].append(op);
+  }
+
+  root["hotspots"] = Json::Value(Json::arrayValue);
+  for(const auto& entry : sorted(hits.data(), hits.size())) {
+    Json::Value spot;
+    spot["pc"] = Json::UInt(entry.second);
+    spot["count"] = Json::UInt64(entry.first);
+    root["hotspots"].append(spot);
+  }
+
+  // Interval buckets start at 0 and then at every power of two
+  Json::Value& draw = root["draws"];
+  draw["count"] = Json::UInt64(draws);
+  draw["min_interval"] = Json::UInt64((draws > 1) ? shortest : 0);
+  draw["max_interval"] = Json::UInt64(longest);
+  draw["mean_interval"] = (draws > 1) ? double(total_interval) / (draws - 1) : 0.0;
+  draw["histogram"] = Json::Value(Json::arrayValue);
+  for(std::size_t bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+    Json::Value range;
+    range["from"] = Json::UInt64((bucket == 0) ? 0 : std::uint64_t(1) << bucket);
+    range["count"] = Json::UInt64(intervals[bucket]);
+    draw["histogram"].append(range);
+  }
+
+  std::ofstream output(path);
+  if(!output.is_open()) {
+    std::cerr << "[CHIP8] Unable to write profile: " << path << std::endl;
+    return;
+  }
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "  ";
+  output << Json::writeString(builder, root) << std::endl;
+}
+
+
+// ------- Profiler private functions
+
+std::vector<std::pair<std::uint64_t, std::size_t>> PROFILER::sorted(const std::uint64_t *counts, const std::size_t& size) {
+  // Non zero counts with their index, largest first
+  std::vector<std::pair<std::uint64_t, std::size_t>> entries;
+  for(std::size_t n = 0; n < size; n++) {
+    if(counts[n] > 0)
+      entries.emplace_back(counts[n], n);
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+    return (a.first != b.first) ? a.first > b.first : a.second < b.second;
+  });
+
+  return entries;
+}
@@ -0,0 +1,170 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - rewind.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- REWIND Class Implementation ------- //
+
+// ------- Rewind public functions
+
+void REWIND::initialize(const std::size_t& bytes) {
+  buffer.assign(bytes, 0);
+  delta.reserve(sizeof(SNAPSHOT) * 2);
+  reset();
+}
+
+
+void REWIND::reset() {
+  started = false;
+  entries.clear();
+  used = 0;
+}
+
+
+void REWIND::push(const SNAPSHOT& state) {
+  // The first snapshot has nothing to be a delta against
+  if(!started) {
+    current = state;
+    started = true;
+    return;
+  }
+
+  // Stepping back from state must give current
+  encode(reinterpret_cast<const Byte*>(&state), reinterpret_cast<const Byte*>(&current), sizeof(SNAPSHOT));
+  if(!store()) {
+    // A delta larger than the whole buffer cuts the history short
+    entries.clear();
+    used = 0;
+  }
+
+  current = state;
+}
+
+
+bool REWIND::pop(SNAPSHOT& state) {
+  // Step back one snapshot, false once the history runs out
+  if(entries.empty())
+    return false;
+
+  const ENTRY entry = entries.back();
+  entries.pop_back();
+  used -= entry.length;
+
+  Byte *target = reinterpret_cast<Byte*>(&current);
+  const Byte *runs = &buffer[entry.offset];
+  std::size_t pos = 0;
+  std::size_t n = 0;
+
+  while(n + 4 <= entry.length) {
+    const std::size_t skip = runs[n] | (runs[n + 1] << 8);
+    const std::size_t count = runs[n + 2] | (runs[n + 3] << 8);
+    n += 4;
+    pos += skip;
+
+    if(pos + count > sizeof(SNAPSHOT) || n + count > entry.length) {
+      std::cerr << "[CHIP8] Rewind history is corrupt." << std::endl;
+      reset();
+      return false;
+    }
+
+    for(std::size_t k = 0; k < count; k++)
+      target[pos + k] ^= runs[n + k];
+
+    pos += count;
+    n += count;
+  }
+
+  state = current;
+  return true;
+}
+
+
+// ------- Rewind private functions
+
+void REWIND::encode(const Byte *from, const Byte *to, const std::size_t& size) {
+  // XOR the two images and keep only the runs that differ
+  delta.clear();
+  std::size_t pos = 0;
+
+  while(pos < size) {
+    const std::size_t start = pos;
+    while(pos < size && from[pos] == to[pos])
+      pos++;
+
+    if(pos == size)
+      break;
+
+    // A literal run ends at REWIND_GAP unchanged bytes in a row
+    const std::size_t first = pos;
+    std::size_t last = pos;
+    while(pos < size && pos - last < REWIND_GAP) {
+      if(from[pos] != to[pos])
+        last = pos + 1;
+      pos++;
+    }
+    pos = last;
+
+    const Word skip = Word(first - start);
+    const Word count = Word(last - first);
+    delta.push_back(Byte(skip));
+    delta.push_back(Byte(skip >> 8));
+    delta.push_back(Byte(count));
+    delta.push_back(Byte(count >> 8));
+
+    for(std::size_t k = first; k < last; k++)
+      delta.push_back(from[k] ^ to[k]);
+  }
+}
+
+
+bool REWIND::store() {
+  const std::size_t length = delta.size();
+  if(length > buffer.size())
+    return false;
+
+  // Append after the newest delta, wrapping to the start when it will not fit
+  std::size_t offset = entries.empty() ? 0 : entries.back().offset + entries.back().length;
+  if(offset + length > buffer.size()) {
+    // Deltas in the skipped tail are the oldest, drop them first
+    while(!entries.empty() && entries.front().offset >= offset)
+      drop();
+    offset = 0;
+  }
+
+  // Drop the oldest deltas the new one would overwrite
+  while(!entries.empty() && entries.front().offset < offset + length &&
+    offset < entries.front().offset + entries.front().length)
+    drop();
+
+  std::copy(delta.begin(), delta.end(), buffer.begin() + offset);
+  entries.push_back(ENTRY{offset, length});
+  used += length;
+  return true;
+}
+
+
+void REWIND::drop() {
+  used -= entries.front().length;
+  entries.pop_front();
+}
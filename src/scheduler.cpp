@@ -0,0 +1,89 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - scheduler.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- SCHEDULER Class Implementation ------- //
+
+// ------- Scheduler public functions
+
+void SCHEDULER::initialize(const unsigned int& hz, const unsigned int& fps) {
+  // Guard against zero rates from the configuration
+  clock = (hz > 0) ? hz : CLOCK_HZ;
+  rate = (fps > 0) ? fps : TIMER_HZ;
+  margin = SCHEDULER_SPIN_MAX;
+  resyncs = 0;
+  reset();
+}
+
+
+void SCHEDULER::reset() {
+  // Start the schedule over from the current time
+  origin = CLOCK::now();
+  frames = 0;
+  accumulator = 0;
+}
+
+
+unsigned int SCHEDULER::next() {
+  // Whole instructions due this frame, the fraction is kept for later ones
+  accumulator += clock;
+  const unsigned int count = accumulator / rate;
+  accumulator %= rate;
+  return count;
+}
+
+
+void SCHEDULER::wait() {
+  // Deadlines are computed from the origin so rounding never accumulates
+  frames++;
+  const CLOCK::time_point deadline = origin +
+    std::chrono::duration_cast<CLOCK::duration>(std::chrono::nanoseconds(frames * 1000000000ull / rate));
+
+  CLOCK::time_point now = CLOCK::now();
+  if(now >= deadline) {
+    // Running late, drop the debt rather than racing to catch up
+    if(now - deadline > std::chrono::nanoseconds(1000000000ull / rate) * SCHEDULER_RESYNC) {
+      origin = now;
+      frames = 0;
+      resyncs++;
+    }
+    return;
+  }
+
+  // Sleep most of the way, the OS may wake us late
+  const CLOCK::time_point wake = deadline - margin;
+  if(now < wake) {
+    std::this_thread::sleep_until(wake);
+    now = CLOCK::now();
+
+    // Follow the oversleep, spinning twice as long as recently needed
+    const CLOCK::duration late = (now > wake) ? now - wake : CLOCK::duration::zero();
+    margin = std::clamp<CLOCK::duration>((margin * 7 + late * 2) / 8, SCHEDULER_SPIN_MIN, SCHEDULER_SPIN_MAX);
+  }
+
+  // Spin out the rest for a precise deadline
+  while(CLOCK::now() < deadline)
+    std::this_thread::yield();
+}
@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - snapshot.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- SNAPSHOT Implementation ------- //
+
+bool SNAPSHOT::valid() const {
+  // Only snapshots of this exact layout can be restored
+  return std::equal(magic, magic + 4, SNAPSHOT_MAGIC) && version == SNAPSHOT_VERSION &&
+    size == sizeof(SNAPSHOT);
+}
+
+
+std::uint64_t SNAPSHOT::digest() const {
+  // 64 bit FNV-1a over the registers and framebuffer, enough to tell two runs apart
+  std::uint64_t value = 14695981039346656037ull;
+  auto mix = [&value](const std::uint64_t& data, const int& bytes) {
+    for(int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+      value = (value ^ Byte(data >> shift)) * 1099511628211ull;
+  };
+
+  for(const Byte& vx : registers)
+    mix(vx, 1);
+  mix(i, 2);
+  mix(pc, 2);
+  mix(sp, 1);
+  for(const Word& address : stack)
+    mix(address, 2);
+  for(const std::uint64_t& row : display)
+    mix(row, 8);
+
+  return value;
+}
+
+
+bool SNAPSHOT::read(const std::string& path) {
+  std::ifstream input(path, std::ios::binary);
+  if(!input.is_open()) {
+    std::cerr << "[CHIP8] Unable to open save state: " << path << std::endl;
+    return false;
+  }
+
+  // Read into a copy so a bad file leaves this snapshot untouched
+  SNAPSHOT loaded;
+  input.read(reinterpret_cast<char*>(&loaded), sizeof(SNAPSHOT));
+  if(input.gcount() != sizeof(SNAPSHOT) || !loaded.valid()) {
+    std::cerr << "[CHIP8] Not a version " << SNAPSHOT_VERSION << " save state: " << path << std::endl;
+    return false;
+  }
+
+  *this = loaded;
+  return true;
+}
+
+
+bool SNAPSHOT::write(const std::string& path) const {
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  output.write(reinterpret_cast<const char*>(this), sizeof(SNAPSHOT));
+
+  if(!output.good()) {
+    std::cerr << "[CHIP8] Unable to write save state: " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
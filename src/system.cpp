@@ -34,13 +34,64 @@ void SYSTEM::initialize(const int argc, const char *argv[]) {
   // Ascertain if a configuration file is present
   config_enabled = fexist("assets/config.json");
   debug_enabled = false;
+  diff_enabled = false;
+  headless = false;
+  profile_enabled = false;
+  timeline_enabled = false;
+  seed_given = false;
+  turbo = TURBO_SPEED;
+  turbo_enabled = false;
+  recording = false;
+  replaying = false;
+  sample = 1;
+  max_cycles = 0;
+  engine = CPU::ENGINE::INTERPRETER;
 
   // Parse the variable passed to the emulator
   parse(argc, argv);
 
-  // Initialize the components
-  display.initialize();
-  cpu.initialize(&display, &debug);
+  // Initialize the components, headless runs never touch SDL
+  if(headless) {
+    display.configure();
+    video = &null_display;
+  } else {
+    display.initialize();
+    video = &display;
+  }
+  cpu.initialize(&debug);
+  cpu.setEngine(engine);
+  cpu.setClock(display.getClock());
+  cpu.setDifferential(diff_enabled);
+
+  // A replay repeats the seed and clock of its recording
+  if(replaying) {
+    if(movie.read(movie_path)) {
+      seed = movie.getSeed();
+      seed_given = true;
+      cpu.setClock(movie.getClock());
+      if(max_cycles == 0)
+        max_cycles = movie.getEnd();
+      std::cout << "[CHIP8] Replaying " << movie.getCount() << " key presses" << std::endl;
+    } else {
+      state = STATE::HALT;
+    }
+  }
+
+  // Without --seed pick one, it is printed so the run can be repeated
+  if(!seed_given)
+    seed = (std::uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+  cpu.setSeed(seed);
+  if(state == STATE::EXEC)
+    std::cout << "[CHIP8] Random seed: " << seed << std::endl;
+
+  if(recording)
+    movie.initialize(seed, display.getClock());
+
+  if(profile_enabled) {
+    profiler.initialize(sample);
+    cpu.setProfiler(&profiler);
+  }
+  timeline.initialize(timeline_enabled);
 
   if(debug_enabled) {
     debug.initialize(debug_path);
@@ -49,8 +100,8 @@ void SYSTEM::initialize(const int argc, const char *argv[]) {
     debug.setEnabled(false);
   }
 
-  // Pull out the delay from the configuration
-  delay = display.getDelay();
+  // Pace frames at the timer rate with the configured instruction clock
+  scheduler.initialize(display.getClock(), TIMER_HZ);
 }
 
 
@@ -60,22 +111,70 @@ void SYSTEM::run() {
 
   // Load the ROM into memory
   cpu.open(file_path, 0x200);
+  has_quicksave = false;
+
+  // Optionally continue from a save state instead of the reset state
+  if(!load_path.empty()) {
+    SNAPSHOT state;
+    if(!state.read(load_path) || !cpu.load(state))
+      return;
+    std::cout << "[CHIP8] Loaded state: " << load_path << std::endl;
+  }
+
   debug.start();
 
-  // Main program function
+  // The screen starts out blank like the framebuffer
+  unseen.clear();
+  published = 0;
+  presented = 0;
+
+  if(headless) {
+    runHeadless();
+    debug.stop();
+    writeProfile();
+    writeMovie();
+    checkReplay();
+    if(timeline_enabled)
+      timeline.write(timeline_path);
+    return;
+  }
+
+  // Emulate on a separate thread so presenting never holds up the CPU
+  history.initialize(REWIND_BYTES);
+  rewinding = false;
+  fast_forward = false;
+  scheduler.reset();
+  running = true;
+  std::thread emulator(&SYSTEM::emulate, this);
+
+  // Main program function, SDL events and rendering stay on this thread
   while(state != STATE::HALT) {
-    // Handle SDL_Events
-    cpu.update();
-    handleEvent();
-    SDL_Delay(delay);
+    {
+      SCOPE span(timeline, TIMELINE::MAIN, "events");
+      handleEvent();
+    }
+
+    // Without a new frame there is no vsync to wait on
+    if(!present()) {
+      SCOPE span(timeline, TIMELINE::MAIN, "idle");
+      SDL_Delay(1);
+    }
   }
 
+  running = false;
+  emulator.join();
+
   debug.stop();
+  writeProfile();
+  writeMovie();
+  if(timeline_enabled)
+    timeline.write(timeline_path);
 }
 
 
 void SYSTEM::finalize() {
   // Finalize the system components
+  cpu.finalize();
   display.finalize();
 }
 
@@ -93,9 +192,7 @@ bool SYSTEM::fexist(const std::string& path) {
 void SYSTEM::parse(const int argc, const char *argv[]) {
   // Catch possible misuse
   if(argc < 2) {
-    std::cerr << "[CHIP8] Usage:\t" << argv[0] << " <ROM_PATH>" << std::endl;
-    std::cerr << "\t\t" << argv[0] << " <ROM_PATH> -D <DEBUG_PATH>" << std::endl;
-    std::cerr << "\t\t" << argv[0] << " -h" << std::endl;
+    usage(argv[0]);
     return;
   }
 
@@ -105,83 +202,398 @@ void SYSTEM::parse(const int argc, const char *argv[]) {
   for(int i = 0; i < argc; i++)
     args.push_back(argv[i]);
 
+  // Handle calls to help
+  if(!args[1].compare("-h") || !args[1].compare("-H")) {
+    std::cout << "[CHIP8] " << _APP_VERSION << " by " << _APP_AUTHOR << std::endl;
+    return;
+  }
 
-  switch(argc) {
-    case 2:
-      {
-        // Handle calls to help
-        if(!args[1].compare("-h") || !args[1].compare("-H")) {
-          std::cout << "[CHIP8] " << _APP_VERSION << " by " << _APP_AUTHOR << std::endl;
-          return;
-        }
+  // Handle the options following the ROM
+  for(std::size_t n = 2; n < args.size(); n++) {
+    if(!args[n].compare("-D") || !args[n].compare("-d")) {
+      if(n + 1 >= args.size()) {
+        usage(argv[0]);
+        return;
+      }
 
-        // Ensure we are using a rom that exists
-        if(fexist(args[1])) {
-          // Configure our system to run the ROM only
-          file_path = args[1];
-          debug_enabled = false;
-          state = STATE::EXEC;
-
-          std::cout << "[CHIP8] Found ROM: " << file_path << std::endl;
-        } else {
-          // Catch missing files
-          std::cerr << "[CHIP8] Unable to find ROM: " << args[1] << std::endl;
-        }
+      if(!TRACE_ENABLED) {
+        std::cerr << "[CHIP8] Tracing is not compiled in, rebuild with -DCHIP8_TRACE=ON." << std::endl;
+        return;
       }
-      break;
-    case 4:
-      {
-        if(!args[2].compare("-D") || !args[2].compare("-d")) {
-          // Ensure we are not reusing logfiles
-          if(fexist(args[3])) {
-            std::cerr << "[CHIP8] File already exists please specify an alternative." << std::endl;
-            break;
-          }
-          // Ensure we are using a rom that exists
-          if(fexist(args[1])) {
-            // Configure our system to run the ROM and debug
-            file_path = args[1];
-            debug_path = args[3];
-            debug_enabled = true;
-            state = STATE::EXEC;
-
-            std::cout << "[CHIP8] Found ROM: " << file_path << std::endl;
-            std::cout << "[CHIP8] Debugging enabled" << std::endl;
-            break;
-          } else {
-            // Catch a missing rom
-            std::cerr << "[CHIP8] Unable to find ROM: " << args[1] << std::endl;
-            break;
-          }
-        }
+
+      // Ensure we are not reusing logfiles
+      debug_path = args[++n];
+      if(fexist(debug_path)) {
+        std::cerr << "[CHIP8] File already exists please specify an alternative." << std::endl;
+        return;
       }
-    default:
-      {
-        // Catch unknown commands
-        std::cerr << "[CHIP8] Usage:\t" << argv[0] << " <ROM_PATH>" << std::endl;
-        std::cerr << "\t\t" << argv[0] << " <ROM_PATH> -D <DEBUG_PATH>" << std::endl;
-        std::cerr << "\t\t" << argv[0] << " -h" << std::endl;
+      debug_enabled = true;
+    } else if(!args[n].compare("--jit")) {
+      engine = CPU::ENGINE::JIT;
+    } else if(!args[n].compare("--headless")) {
+      headless = true;
+    } else if(!args[n].compare("--cycles") && n + 1 < args.size()) {
+      max_cycles = std::strtoull(args[++n].c_str(), nullptr, 10);
+    } else if(!args[n].compare("--profile")) {
+      if(n + 1 >= args.size()) {
+        usage(argv[0]);
         return;
       }
+      profile_path = args[++n];
+      profile_enabled = true;
+    } else if(!args[n].compare("--timeline")) {
+      if(n + 1 >= args.size()) {
+        usage(argv[0]);
+        return;
+      }
+      timeline_path = args[++n];
+      timeline_enabled = true;
+    } else if(!args[n].compare("--turbo") && n + 1 < args.size()) {
+      const unsigned long speed = std::strtoul(args[++n].c_str(), nullptr, 10);
+      turbo = static_cast<unsigned int>(std::min<unsigned long>(std::max(1ul, speed), TURBO_MAX));
+      turbo_enabled = true;
+      if(speed > TURBO_MAX)
+        std::cerr << "[CHIP8] Turbo limited to " << TURBO_MAX << " times" << std::endl;
+    } else if(!args[n].compare("--record") && n + 1 < args.size()) {
+      movie_path = args[++n];
+      recording = true;
+    } else if(!args[n].compare("--replay") && n + 1 < args.size()) {
+      movie_path = args[++n];
+      replaying = true;
+      headless = true;
+    } else if(!args[n].compare("--load") && n + 1 < args.size()) {
+      load_path = args[++n];
+    } else if(!args[n].compare("--seed") && n + 1 < args.size()) {
+      seed = std::strtoull(args[++n].c_str(), nullptr, 10);
+      seed_given = true;
+    } else if(!args[n].compare("--sample") && n + 1 < args.size()) {
+      sample = std::strtoul(args[++n].c_str(), nullptr, 10);
+    } else if(!args[n].compare("--threaded")) {
+      engine = CPU::ENGINE::THREADED;
+    } else if(!args[n].compare("--diff")) {
+      engine = CPU::ENGINE::JIT;
+      diff_enabled = true;
+    } else {
+      // Catch unknown commands
+      usage(argv[0]);
+      return;
+    }
+  }
+
+  // Movies always start from the reset state, which a loaded state is not
+  if((recording || replaying) && !load_path.empty()) {
+    std::cerr << "[CHIP8] --load cannot be combined with --record or --replay." << std::endl;
+    return;
+  }
+
+  // Ensure we are using a rom that exists
+  if(!fexist(args[1])) {
+    std::cerr << "[CHIP8] Unable to find ROM: " << args[1] << std::endl;
+    return;
   }
+
+  // Configure our system to run the ROM
+  file_path = args[1];
+  state_path = file_path + ".state";
+  state = STATE::EXEC;
+
+  std::cout << "[CHIP8] Found ROM: " << file_path << std::endl;
+  if(debug_enabled)
+    std::cout << "[CHIP8] Debugging enabled" << std::endl;
+}
+
+
+void SYSTEM::usage(const std::string& name) {
+  std::cerr << "[CHIP8] Usage:\t" << name << " <ROM_PATH> [OPTIONS]" << std::endl;
+  std::cerr << "\t\t" << name << " -h" << std::endl;
+  std::cerr << "[CHIP8] Options:" << std::endl;
+  std::cerr << "\t-D <DEBUG_PATH>\tTrace the CPU state to DEBUG_PATH, see chip8-trace" << std::endl;
+  std::cerr << "\t--headless\tRun without a window at full speed" << std::endl;
+  std::cerr << "\t--cycles <N>\tStop after N instructions" << std::endl;
+  std::cerr << "\t--jit\t\tTranslate code to native x86-64 where possible" << std::endl;
+  std::cerr << "\t--threaded\tUse the threaded code interpreter" << std::endl;
+  std::cerr << "\t--diff\t\tRun the JIT and interpreter side by side and compare" << std::endl;
+  std::cerr << "\t--load <PATH>\tStart from a save state, F5 and F9 quick save and load" << std::endl;
+  std::cerr << "\t--turbo <N>\tRun N times the configured speed, or hold Tab" << std::endl;
+  std::cerr << "\t--record <PATH>\tRecord every key press to PATH" << std::endl;
+  std::cerr << "\t--replay <PATH>\tRun headless with the key presses recorded in PATH" << std::endl;
+  std::cerr << "\t--seed <N>\tSeed the CXNN random numbers to repeat a run" << std::endl;
+  std::cerr << "\t--profile <PATH>\tWrite opcode and hot spot counts to PATH as JSON" << std::endl;
+  std::cerr << "\t--sample <N>\tProfile every Nth instruction only" << std::endl;
+  std::cerr << "\t--timeline <PATH>\tWrite frame timing spans to PATH as a Chrome trace" << std::endl;
+}
+
+
+void SYSTEM::runHeadless() {
+  // Run at full speed until the CPU halts, waits for a key or hits the limit
+  const std::uint64_t batch = 0x10000;
+  auto start = std::chrono::steady_clock::now();
+
+  while(!cpu.isHalt()) {
+    // Hand over recorded key presses as emulated time reaches them
+    int key;
+    while(replaying && movie.due(cpu.getCycles(), key))
+      cpu.setKey(key);
+
+    // A replay runs on to the cycle its recording stopped at even while waiting
+    const bool pending = replaying && !movie.finished();
+    if(cpu.isWaiting() && !pending && !(replaying && max_cycles > 0))
+      break;
+
+    std::uint64_t budget = batch;
+    if(max_cycles > 0) {
+      if(cpu.getCycles() >= max_cycles)
+        break;
+      budget = std::min(batch, max_cycles - cpu.getCycles());
+    }
+
+    // Stop exactly on the cycle of the next recorded press
+    if(pending)
+      budget = std::min(budget, movie.next() - cpu.getCycles());
+
+    {
+      SCOPE span(timeline, TIMELINE::EMULATOR, "cpu");
+      cpu.run(budget);
+    }
+    publish();
+    present();
+  }
+
+  if(cpu.isWaiting() && !replaying)
+    std::cerr << "[CHIP8] Waiting for a key with no input available." << std::endl;
+
+  // Report the emulated instruction count and throughput
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  std::cout << "[CHIP8] Executed " << cpu.getCycles() << " instructions in "
+  << seconds.count() << "s" << std::endl;
+}
+
+
+void SYSTEM::writeMovie() {
+  // The recording ends where the CPU stopped
+  if(!recording)
+    return;
+
+  SNAPSHOT end;
+  cpu.save(end);
+  if(movie.write(movie_path, cpu.getCycles(), end.digest()))
+    std::cout << "[CHIP8] Recorded " << movie.getCount() << " key presses: " << movie_path << std::endl;
+}
+
+
+void SYSTEM::checkReplay() {
+  // A replay that reached the end of its recording must finish in the same state
+  if(!replaying)
+    return;
+
+  if(cpu.getCycles() != movie.getEnd()) {
+    std::cout << "[CHIP8] Replay stopped at cycle " << cpu.getCycles() << " of "
+    << movie.getEnd() << ", final state not checked" << std::endl;
+    return;
+  }
+
+  SNAPSHOT end;
+  cpu.save(end);
+  if(end.digest() == movie.getDigest())
+    std::cout << "[CHIP8] Replay matches the recording" << std::endl;
+  else
+    std::cerr << "[CHIP8] Replay diverged from the recording, registers or framebuffer differ" << std::endl;
+}
+
+
+void SYSTEM::writeProfile() {
+  // Summarise the profile and keep the full counts for later
+  if(!profile_enabled)
+    return;
+
+  profiler.report(std::cout);
+  profiler.write(profile_path);
+}
+
+
+void SYSTEM::publish() {
+  // Hand the framebuffer over only when CLS or DXYN changed it
+  if(!cpu.isDirty())
+    return;
+
+  SCOPE span(timeline, TIMELINE::EMULATOR, "publish");
+
+  // Forget the areas of frames the render side has already shown
+  const std::uint64_t shown = presented.load(std::memory_order_acquire);
+  while(!unseen.empty() && unseen.front().sequence <= shown)
+    unseen.pop_front();
+
+  unseen.push_back(DAMAGE{++published, cpu.getDirty()});
+  if(unseen.size() > DAMAGE_MAX) {
+    unseen[1].area.merge(unseen[0].area);
+    unseen.pop_front();
+  }
+
+  // Skipped frames are never shown so their areas ride along
+  UPDATE& update = frames.back();
+  update.frame = cpu.getDisplay();
+  update.sequence = published;
+  update.area = RECT{};
+  for(const DAMAGE& damage : unseen)
+    update.area.merge(damage.area);
+
+  frames.publish();
+  cpu.clearDirty();
+}
+
+
+bool SYSTEM::present() {
+  // Show the newest published frame, older ones are dropped
+  if(!frames.update())
+    return false;
+
+  // Headless runs present from the CPU thread
+  const TIMELINE::TRACK track = headless ? TIMELINE::EMULATOR : TIMELINE::MAIN;
+  SCOPE span(timeline, track, "present");
+
+  const UPDATE& update = frames.front();
+  {
+    SCOPE inner(timeline, track, "draw");
+    video->draw(update.frame, update.area);
+  }
+  presented.store(update.sequence, std::memory_order_release);
+  return true;
+}
+
+
+void SYSTEM::emulate() {
+  // The CPU thread, it owns the CPU until running is cleared
+  while(running) {
+    INPUT input;
+    while(inputs.pop(input))
+      apply(input);
+
+    // Fast forward by running several frames' worth before each publish,
+    // the renderer only ever shows the newest so slow presents skip frames
+    const bool fast = turbo_enabled || fast_forward;
+    const unsigned int count = scheduler.next();
+    frame(fast ? count * turbo : count);
+
+    // Publish the frame once however many sprites it drew
+    publish();
+
+    SCOPE span(timeline, TIMELINE::EMULATOR, "sleep");
+    scheduler.wait();
+  }
+}
+
+
+void SYSTEM::frame(const unsigned int& count) {
+  // While rewinding step back one recorded frame instead of running
+  if(rewinding) {
+    SCOPE span(timeline, TIMELINE::EMULATOR, "rewind");
+    if(history.pop(frame_state) && cpu.load(frame_state) && recording)
+      movie.truncate(frame_state.presses);
+    return;
+  }
+
+  // Run a frame's worth of instructions, timers follow emulated time
+  {
+    SCOPE span(timeline, TIMELINE::EMULATOR, "cpu");
+    unsigned int executed = 0;
+    while(executed < count && !cpu.isHalt())
+      executed += cpu.run(count - executed);
+  }
+
+  // Record the frame for rewinding
+  SCOPE span(timeline, TIMELINE::EMULATOR, "snapshot");
+  cpu.save(frame_state);
+  frame_state.presses = std::uint32_t(movie.getCount());
+  history.push(frame_state);
 }
 
 
 void SYSTEM::handleEvent() {
   // Handle key press events and attempts to close the SDL window
-  if (SDL_PollEvent(&event)) {
+  while(SDL_PollEvent(&event)) {
     switch(event.type) {
       case SDL_QUIT:
         state = STATE::HALT;
         break;
+      case SDL_KEYDOWN:
+        if(event.key.keysym.sym == rewind_key && !event.key.repeat)
+          inputs.push(INPUT{INPUT::TYPE::REWIND, 1});
+        else if(event.key.keysym.sym == turbo_key && !event.key.repeat)
+          inputs.push(INPUT{INPUT::TYPE::TURBO, 1});
+        break;
       case SDL_KEYUP:
         for(unsigned int n = 0; n < 16; n++) {
           if(event.key.keysym.sym == chip8_key[n])
-            cpu.setKey(n);
+            inputs.push(INPUT{INPUT::TYPE::KEY, int(n)});
         }
+
+        if(event.key.keysym.sym == save_key)
+          inputs.push(INPUT{INPUT::TYPE::SAVE, 0});
+        else if(event.key.keysym.sym == load_key)
+          inputs.push(INPUT{INPUT::TYPE::LOAD, 0});
+        else if(event.key.keysym.sym == rewind_key)
+          inputs.push(INPUT{INPUT::TYPE::REWIND, 0});
+        else if(event.key.keysym.sym == turbo_key)
+          inputs.push(INPUT{INPUT::TYPE::TURBO, 0});
         break;
       default:
         break;
     }
   }
 }
+
+
+void SYSTEM::apply(const INPUT& input) {
+  // Runs on the CPU thread, the only thread touching the CPU
+  switch(input.type) {
+    case INPUT::TYPE::KEY:
+      if(recording)
+        movie.record(cpu.getCycles(), input.value);
+      cpu.setKey(input.value);
+      break;
+    case INPUT::TYPE::SAVE:
+      save();
+      break;
+    case INPUT::TYPE::LOAD:
+      load();
+      break;
+    case INPUT::TYPE::REWIND:
+      rewinding = (input.value != 0);
+      break;
+    case INPUT::TYPE::TURBO:
+      fast_forward = (input.value != 0);
+      break;
+  }
+}
+
+
+void SYSTEM::save() {
+  // Keep the state in memory and on disk for the next session
+  cpu.save(quicksave);
+  has_quicksave = true;
+
+  if(quicksave.write(state_path))
+    std::cout << "[CHIP8] Saved state: " << state_path << std::endl;
+}
+
+
+void SYSTEM::load() {
+  // Fall back to the file when nothing was saved this session
+  if(!has_quicksave)
+    has_quicksave = quicksave.read(state_path);
+
+  if(!has_quicksave)
+    return;
+
+  // The state may come from another session or an abandoned timeline,
+  // so the movie ends here rather than follow it
+  if(recording && quicksave.valid()) {
+    writeMovie();
+    recording = false;
+    std::cout << "[CHIP8] Loading a state ended the recording." << std::endl;
+  }
+
+  if(!cpu.load(quicksave))
+    return;
+  std::cout << "[CHIP8] Loaded state: " << state_path << std::endl;
+}
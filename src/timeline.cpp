@@ -0,0 +1,95 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - timeline.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- TIMELINE Class Implementation ------- //
+
+// ------- Timeline public functions
+
+void TIMELINE::initialize(const bool& enable) {
+  enabled = enable;
+  origin = std::chrono::steady_clock::now();
+  counts.fill(0);
+
+  // Size the rings up front so recording never allocates mid frame
+  for(std::vector<SPAN>& spans : tracks) {
+    spans.clear();
+    if(enabled)
+      spans.resize(TIMELINE_SPANS);
+  }
+}
+
+
+void TIMELINE::write(const std::string& path) {
+  // Only call once every thread recording spans has finished
+  static const char *names[TIMELINE_TRACKS] = { "Main", "Emulator" };
+
+  Json::Value root;
+  Json::Value& events = root["traceEvents"];
+  events = Json::Value(Json::arrayValue);
+
+  for(std::size_t track = 0; track < TIMELINE_TRACKS; track++) {
+    // Name the thread so the viewer labels the track
+    Json::Value meta;
+    meta["name"] = "thread_name";
+    meta["ph"] = "M";
+    meta["pid"] = 1;
+    meta["tid"] = Json::UInt(track);
+    meta["args"]["name"] = names[track];
+    events.append(meta);
+
+    // Complete events from the oldest kept span, timestamps are in microseconds
+    const std::uint64_t first = counts[track] > TIMELINE_SPANS ? counts[track] - TIMELINE_SPANS : 0;
+    for(std::uint64_t index = first; index < counts[track]; index++) {
+      const SPAN& span = tracks[track][index % TIMELINE_SPANS];
+      Json::Value event;
+      event["name"] = span.name;
+      event["cat"] = "chip8";
+      event["ph"] = "X";
+      event["pid"] = 1;
+      event["tid"] = Json::UInt(track);
+      event["ts"] = span.start / 1000.0;
+      event["dur"] = span.duration / 1000.0;
+      events.append(event);
+    }
+
+    if(first > 0) {
+      std::cerr << "[CHIP8] Timeline " << names[track] << " track wrapped, overwrote the oldest "
+      << first << " spans." << std::endl;
+    }
+  }
+  root["displayTimeUnit"] = "ms";
+
+  std::ofstream output(path);
+  if(!output.is_open()) {
+    std::cerr << "[CHIP8] Unable to write timeline: " << path << std::endl;
+    return;
+  }
+
+  // Traces get large, skip the indentation
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  output << Json::writeString(builder, root) << std::endl;
+}
@@ -0,0 +1,51 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - timer.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+// ------- CHIP8_TIMER Implementation ------- //
+
+void CHIP8_TIMER::reset() {
+  // Reset the timers and emulated time
+  delay = 0;
+  sound = 0;
+  accumulator = 0;
+  elapsed = 0;
+}
+
+
+void CHIP8_TIMER::setClock(const unsigned int& hz) {
+  // Guard against a zero clock from the configuration
+  clock = (hz > 0) ? hz : CLOCK_HZ;
+  accumulator = 0;
+}
+
+
+void CHIP8_TIMER::tick() {
+  // Count down once for every whole 1/TIMER_HZ of emulated time
+  const std::uint64_t ticks = accumulator / clock;
+  accumulator %= clock;
+
+  delay = (delay > ticks) ? delay - ticks : 0;
+  sound = (sound > ticks) ? sound - ticks : 0;
+}
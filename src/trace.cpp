@@ -0,0 +1,138 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+
+chip8 - trace.cpp
+
+Copyright (c) 2020 Christopher M. Short
+
+This file is part of chip8.
+
+chip8 is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+chip8 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with chip8. If not, see <https://www.gnu.org/licenses/>.
+
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "chip8.hpp"
+
+
+// ------- TRACE Class Implementation ------- //
+
+// ------- Trace public functions
+
+void TRACE::initialize(const int argc, const char *argv[]) {
+  ready = false;
+
+  // Parse the variable passed to the trace tool
+  parse(argc, argv);
+  if(!ready)
+    return;
+
+  // Open the trace and check it was written by a compatible DEBUG
+  input.open(trace_path, std::ifstream::in | std::ifstream::binary);
+  if(!input.is_open()) {
+    std::cerr << "[CHIP8] Unable to open trace: " << trace_path << std::endl;
+    ready = false;
+    return;
+  }
+
+  ready = header();
+}
+
+
+void TRACE::run() {
+  if(!ready)
+    return;
+
+  if(output_path.empty()) {
+    convert(std::cout);
+    return;
+  }
+
+  std::ofstream output(output_path);
+  convert(output);
+}
+
+
+void TRACE::finalize() {
+  if(input.is_open())
+    input.close();
+}
+
+
+// ------- Trace private functions
+
+void TRACE::parse(const int argc, const char *argv[]) {
+  if(argc < 2 || argc > 3) {
+    usage(argv[0]);
+    return;
+  }
+
+  trace_path = argv[1];
+  if(!trace_path.compare("-h") || !trace_path.compare("-H")) {
+    usage(argv[0]);
+    return;
+  }
+
+  if(argc == 3)
+    output_path = argv[2];
+
+  ready = true;
+}
+
+
+void TRACE::usage(const std::string& name) {
+  std::cerr << "[CHIP8] Usage:\t" << name << " <TRACE_PATH> [TEXT_PATH]" << std::endl;
+  std::cerr << "[CHIP8] Prints the trace written by -D as text, to TEXT_PATH if given" << std::endl;
+}
+
+
+bool TRACE::header() {
+  DEBUG::HEADER header;
+  input.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+  if(!input || !std::equal(TRACE_MAGIC, TRACE_MAGIC + 4, header.magic)) {
+    std::cerr << "[CHIP8] Not a chip8 trace: " << trace_path << std::endl;
+    return false;
+  }
+
+  if(header.version != TRACE_VERSION || header.size != sizeof(DEBUG::RECORD)) {
+    std::cerr << "[CHIP8] Unsupported trace version " << header.version << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+
+void TRACE::convert(std::ostream& out) {
+  std::vector<DEBUG::RECORD> block(TRACE_BLOCK);
+
+  // Print the debug header
+  for(int i = 0; i < 50; i++) out << "#";
+  out << " DEBUGGING ";
+  for(int i = 0; i < 51; i++) out << "#";
+  out << '\n';
+
+  // Read and print whole blocks of records
+  while(input) {
+    input.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(DEBUG::RECORD));
+    const std::size_t count = input.gcount() / sizeof(DEBUG::RECORD);
+
+    for(std::size_t n = 0; n < count; n++)
+      DEBUG::format(out, block[n]);
+  }
+
+  // Print out our footer
+  for(int i = 0; i < 112; i++)
+    out << "#";
+  out << std::endl << std::endl;
+}